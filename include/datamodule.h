@@ -3,7 +3,8 @@
 ** (c) 2018 all rights reserved
 **
 ** The Datamodule class is an implementation of a logistic regression algorithm that uses a sparse 
-** vector format. It uses the Svect class implementation for a sparse vector container.
+** vector format. It uses the Svect class implementation for a sparse vector container and the
+** Smat class (compressed sparse rows) for the features matrix.
 */
 
 #ifndef DATAMODULE_H
@@ -23,23 +24,69 @@ using namespace std;
 #define FN 2 // false negative
 #define TN 3 // true negative
 
+/*
+** Defining the RAND macro and component parts globally so that a psuedorandom number 
+** can be supplied in any necessary function with no danger of repeating the same
+** sequence in multiple function calls, but retain the dertministic nature of the
+** pseudorandom sequence application-wide if desired.  The engine and distribution
+** are defined in dict.cpp.  Each thread has its own copy of them, so worker threads
+** never share (or race on) a sequence, and the sequence seen by the main thread is 
+** the same no matter how many workers are running.
+*/
+extern thread_local default_random_engine             rand_gen;
+extern thread_local uniform_real_distribution<double> rand_distr;
+#define RAND rand_distr(rand_gen)
+
+#define SOLVER_GRADIENT 0 // gradient ascent with a backtracking line search
+#define SOLVER_LBFGS    1 // limited memory BFGS (quasi-Newton)
+#define SOLVER_NEWTONCG 2 // Newton's method with conjugate gradient solves of the Hessian
+#define SOLVER_SGD      3 // mini-batch stochastic gradient descent
+#define SOLVER_ADAGRAD  4 // mini-batch SGD with per-weight (Adagrad) step sizes
+#define SOLVER_ADAM     5 // mini-batch SGD with Adam moment estimates
+
+/*
+** The solver_opts struct holds the settings that control how getsoln() iterates to a
+** solution.  Iteration stops when the change in the objective function from one 
+** iteration to the next is less than "epsilon" (relative to the size of the objective
+** function), when the norm of the gradient is less than "gtol", or after "maxiter" 
+** iterations.  For the stochastic methods an iteration is one pass (epoch) over the
+** examples in a random order, taken "batch" examples at a time with a step size of
+** rate/(1 + decay*epoch).  A small L2 penalty ("lambda") keeps the weights finite when the positive
+** and negative examples can be separated perfectly, which is common for rare words.
+*/
+struct solver_opts {
+  solver_opts(void);            // default constructor (sets the defaults)
+
+  int    method;                // which optimizer to use (SOLVER_xxx)
+  int    maxiter;               // maximum number of iterations
+  double epsilon;               // relative change in the objective function to stop at
+  double gtol;                  // gradient norm to stop at
+  double lambda;                // L2 penalty on the weights
+  int    history;               // number of correction pairs kept by L-BFGS
+  int    cgiter;                // maximum conjugate gradient iterations per Newton step
+  int    batch;                 // number of examples per step (stochastic methods)
+  double rate;                  // initial step size (stochastic methods, 0 = method default)
+  double decay;                 // step size decay per epoch (stochastic methods)
+};
+
 class Datamodule {
 public:
   Datamodule();                                   // default constructor
   ~Datamodule();                                  // destructor
 
   bool   read_input(char **, bool = true);        // read_input reads input files
-  void   LLcomp(Svect&, Svect&, Svect&, Svect*);  // calc objective function components
-  double LL(Svect&, Svect&, Svect*);              // returns the objective function sum
-  int    getsoln(double = 0.001, int = 100);      // iterate to a solution: 
+  void   LLcomp(Svect&, Svect&, Svect&, Smat*);   // calc objective function components
+  double LL(Svect&, Svect&, Smat*);               // returns the objective function sum
+  int    getsoln(const solver_opts& = solver_opts()); // iterate to a solution
   void   pred(void);                              // the predictive function
   void   apply_threshold(double = 0.999);         // apply a threshold limiter to results
   void   calc_conf(double* = nullptr);            // calculate confusion numbers
   void   outdata(string);                         // writes TPR/FPR data to a file
   void   set_weights(Datamodule&);                // copies the weights
   void   set_weights(Svect&);                     // sets all of the weights
-  void   set_features(Svect*);                    // sets the features array pointer (does NOT deep copy)
+  void   set_features(Smat*);                     // sets the features matrix pointer (does NOT deep copy)
   void   set_observations(Svect&);                // sets the observations data                
+  void   set_dense(bool);                         // sets whether to solve with compacted dense weights
   void   get_weights(Svect&);                     // gets the calculated weights
 
   int    examples(void);                          // returns the number of examples in the dataset
@@ -52,13 +99,31 @@ public:
   friend int xmat_split(Datamodule&, double, Datamodule&, Datamodule&);
 
 private:
+  double objective(Dvect&, Dvect&);               // the objective function and its gradient
+  void   hessvec(Dvect&, Dvect&);                 // the Hessian times a vector
+  double linesearch(Dvect&, double, Dvect&, Dvect&, double&, Dvect&, Dvect&);
+  bool   converged(double, double, Dvect&, const solver_opts&);
+  int    solve_gradient(Dvect&, const solver_opts&);
+  int    solve_lbfgs(Dvect&, const solver_opts&);
+  int    solve_newtoncg(Dvect&, const solver_opts&);
+  int    solve_stochastic(Dvect&, const solver_opts&);
+
   Svect  wvec;   // weights vector
-  Svect *xvec;   // features vector
+  Smat  *xvec;   // features matrix (one row per example)
   Svect  yvec;   // observations vector
   Svect  rvec;   // results vector
   Svect  lvec;   // objective function components
   Svect  tvec;   // threshold limited vector
   Svect  cvec;   // confusion matrix components
+  bool   dense;  // solve on the compacted features with a dense weights array
+
+  // working data used while iterating to a solution
+  Smat  *sx;     // the features being solved on (possibly compacted)
+  Dvect  yd;     // dense copy of the observations
+  Dvect  zd;     // wTx for each example (then the logistic function)
+  Dvect  sd;     // log(1+exp(wTx)) for each example
+  Dvect  dd;     // the Hessian diagonal for each example: f*(1-f)
+  double lambda; // the L2 penalty on the weights
 };
 
 // randomly splits the matrices (weights, observed, features) into two subsets of the data
@@ -67,10 +132,10 @@ int xmat_split(Datamodule&, double, Datamodule&, Datamodule&);
 
 // calculates the components of the log-liklihood function
 // LLcomp(output-vector, weights-vector, observed, features)
-void LLcomp(Svect&, Svect&, Svect&, Svect*);
+void LLcomp(Svect&, Svect&, Svect&, Smat*);
 
 // returns the log-liklihood (scalar)
 // LL(weights-vector, observed, features)
-double LL(Svect&, Svect&, Svect*);
+double LL(Svect&, Svect&, Smat*);
 
 #endif // DATAMODULE_H
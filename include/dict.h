@@ -4,13 +4,18 @@
 #include <iomanip>
 #include <string>
 #include <list>
+#include <deque>
 #include <set>
 #include <random>
+#include <mutex>
+#include <vector>
+#include <algorithm>
 
 #include "../include/vect.h"
 #include "../include/wdata.h"
 #include "../include/wordvect.h"
 #include "../include/datamodule.h"
+#include "../include/mmodel.h"
 
 #ifndef DICT_H
 #define DICT_H
@@ -18,25 +23,10 @@
 using namespace std;
 using namespace std::rel_ops;
 
-#define NVEC 4     // the size of the word vector predecessor array (# of priors)
 #define MAXD 50000 // the nominal size of the dictionary for use in Svect operations
 
-/*
-** Defining the RAND macro and component parts globally so that a psuedorandom number 
-** can be supplied in any necessary function with no danger of repeating the same
-** sequence in multiple function calls, but retain the dertministic nature of the
-** pseudorandom sequence application-wide if desired.
-*/
-#define RAND rand_distr(rand_gen)
-
-/*
-** The classcompv structure compares two wordvectors for sorting purposes.  
-** This is the format that must be used for the multiset container declaration.
-*/
-struct classcompv {
-  bool operator() (const wordvect &lhs, const wordvect &rhs) const
-  { return (lhs.comp(rhs)); }
-};
+#define PAK_MAGIC   "WPAK" // identifies a packed model file
+#define PAK_VERSION 1      // the version of the packed model file format
 
 /*
 ** The classcompf structure compares two strings for sorting purposes.  
@@ -48,8 +38,19 @@ struct classcompf {
 };
 
 /*
-** The "Dict" class stores the dictionary that is used to score the vectors.  A tree structure
-** is used, which greatly enhances lookup and retrieval speeds O(log n) vice O(n).
+** The Hslot structure is one slot of the hash table used to look words up by their
+** text.  It holds the hash of the word and its ordinal (-1 if the slot is empty); the
+** text itself is only stored once, in the wordvect that the ordinal refers to.
+*/
+struct Hslot { uint32_t h; int o; };
+
+#define HMIN 1024  // the initial number of slots in the hash table (must be a power of two)
+
+/*
+** The "Dict" class stores the dictionary that is used to score the vectors.  The words are
+** kept in the order that they were added, and they are found by text through an open
+** addressing hash table (one probe sequence, O(1) on average) and by ordinal through a
+** table indexed by ordinal.
 */
 class Dict {
 public:
@@ -59,43 +60,79 @@ public:
   void      clear(void);                  // clears all data in the dict
   void      thresh(int=0);                // sets the threshold for group operations
   int       thresh(void);                 // gets the current threshold
+  void      negratio(int);                // sets the number of negative examples for each positive one
+  int       negratio(void) const;         // gets the number of negative examples for each positive one
+  void      solver(int);                  // sets the method that the weights are solved with (SOLVER_xxx)
+  int       solver(void) const;           // gets the method that the weights are solved with
   bool      addword(wordvect&,bool=true); // adds a word to the dictionary
-  bool      addword(string);
-  bool      exist(string);                // returns true if the word is already added
+  bool      addword(wordvect&&,bool=true);
+  WVit      addword(const string&,int=1); // (the count is the number of occurrences to add; returns the entry)
+  void      addtoken(WVit);               // records the next word of the training text in the corpus
+  bool      exist(const string&);         // returns true if the word is already added
   WVit      find(wordvect&);              // finds an entry in the dictionary and returns an iterator
-  WVit      find(string);
+  WVit      find(const string&);
   bool      check(WVit);                  // performs checks to determine if a wordvect iterator is valid
   void      write(void);                  // writes the dictionary index file to the dict directory
   void      read(void);                   // reads the dictionary index file from the dict directory
+  bool      save(void);                   // writes all of the models to the packed model file
+  int       load(void);                   // reads all of the models from the packed model file
+  int       import(void);                 // imports the models from the data files of older versions
+  bool      map(void);                    // maps the read-only model file for scoring guesses
+  void      unmap(void);                  // stops using the read-only model file
+  bool      mapped(void) const;           // returns whether the read-only model file is in use
   void      loadnix(string,string);       // loads a specified list of words into the nix multiset
   string    getnew(void);                 // gets the next word to regress, by priority
   void      prioritize(void);             // constructs the priority list based on word frequency
   int*      get_guesses(Svect&);          // calculates which words are likely to follow a specific word stream
   int       num_guesses(void);            // return the number of valid guesses
   void      show_guesses(void);           // show the current list of guesses via stdout
+  void      build_index(void);            // builds the inverted precursor index from the models
+  void      reindex(void);                // marks the inverted precursor index as out of date
   const wordvect& get(wordvect&);         // finds an entry in the dictionary and returns a reference to that item
-  const wordvect& get(string);
+  const wordvect& get(const string&);
 
   // allows accessing an individual element via brackets
   const wordvect& operator[](wordvect&);
-  const wordvect& operator[](string);
+  const wordvect& operator[](const string&);
   const wordvect& operator[](int);
 
   friend ostream& operator<<(ostream&,const Dict&); // outputs all elements to a stream
 
 private:
+  void invert(const vector<char>&); // fills the index arrays from the models of the chosen words
+  int  probe(const string&,uint32_t) const; // finds the hash table slot for a word (or where it goes)
+  WVit insert(wordvect&&,uint32_t,int,bool); // adds a new word at an empty hash table slot
+  void rehash(int);                 // resizes the hash table
+  uint32_t vochash(void) const;     // hashes the words and their ordinals (to match a model file)
+
   list<WVit>                    train;    // the words in the training set (random subset of words)
   list<WVit>                    test;     // the words in the testing set (random subset of words)
-  multiset<wordvect,classcompv> words;    // the set of words that make up the dictionary
+  deque<wordvect>               words;    // the words that make up the dictionary (in the order added)
+  Corpus                        corpus;   // the training text (the ordinal of each word, in order)
+  Sampler                       negs;     // the examples of the training set (negative examples are drawn from it)
+  solver_opts                   sopts;    // the settings that the weights are solved with
+  vector<Hslot>                 slots;    // hash table of the words (the size is a power of two)
   multiset<string,classcompf>   nix;      // the set of words explicitly not prioritized for regression
   multiset<string,classcompf>   stand;    // the set of common words always added to a list of candidates
   list<WVit> prilist;    // list of iterators sorted by frequency priority
+  vector<WVit> byord;    // pointer to each word indexed by ordinal (&empty if there is none)
+  vector<char> intrain;  // flags the words in the training set (indexed by ordinal)
   wordvect empty;        // an empty wordvect to return in cases where the requested entry does not exist
   int      nord;         // the next ordinal number
   int      thr;          // count threshold for group operations (like display)
   double   ptrain;       // the probability of being copied into the train wordvect
   double   ptest;        // the probability of being copied into the test wordvect
   bool     prioritized;  // flag indicating whether the current list has a valid priorization
+  mutex    qlock;        // serializes access to the priority list (getnew() is called by workers)
+  vector<int>    poff;   // the offset of the postings for each precursor ordinal (plus the end)
+  vector<int>    pword;  // the model number of the word for each posting
+  vector<double> pwt;    // the weight of the word at that ordinal for each posting
+  vector<int>    pord;   // the ordinal of the word for each model
+  vector<int>    psz;    // the nominal size of the weights for each model
+  Dvect          iacc;   // weighted sum accumulators (all zero between calls)
+  vector<char>   imark;  // flags for the models touched by the current guess (all zero between calls)
+  bool     indexed;      // flag indicating whether the inverted precursor index is valid
+  Mmodel   mm;           // the read-only model file (used instead of the index when open)
   int      guesses[256]; // contains the results of the last guess calculation
   int      nguesses;     // number of valid guesses in the guesses array
 };
@@ -0,0 +1,39 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library implements the reading of a training file into the dictionary (the words,
+** the corpus and the precursor examples).  A file can be read serially, up to a number of
+** words and then resumed where it stopped (processfile()), or read whole in parallel shards
+** by several workers (readshards()), which gives the same dictionary as a serial read.
+*/
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <string>
+
+#include "../include/dict.h"
+#include "../include/token.h"
+
+using namespace std;
+
+/*
+** The Ingest structure holds the state of the training file between calls to
+** processfile(): where the reading stopped, so that more words can be added without
+** reading the file again (the precursors of the next word are already in the corpus
+** of the dictionary).
+*/
+struct Ingest {
+  string    fname;  // the file being read (empty = nothing to resume)
+  Tokenizer tok;    // the tokenizer, left where the reading stopped
+  int       n;      // the number of words read so far
+
+  Ingest() : n(0) { }
+}; // end Ingest
+
+// processfile(file, dict, state, maxwords (0 = all), # of workers, resume)
+void processfile(string, Dict&, Ingest&, int=1000, int=1, bool=false);
+void readshards(string, Dict&, int);  // reads a whole file in parallel shards
+
+#endif // INGEST_H
@@ -0,0 +1,76 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library implements a read-only model file (Mmodel) that holds the inverted precursor
+** index used to score guesses: for every precursor ordinal, the models (words) that have a
+** weight at that ordinal and the weights themselves.  The arrays are stored exactly as they
+** are used, so on Linux the file is memory mapped and the scoring runs directly off of the
+** mapped pages: opening the file costs the same no matter how large the vocabulary is (only
+** the header is checked; the postings are checked as they are scored), and every process on
+** the same host that maps the file shares one copy in the page cache.  On other platforms
+** the file is read into memory in one piece instead.
+**
+** The file layout is a 32 byte header ("WMAP", version, number of ordinals, number of models,
+** number of postings, number of words in the dictionary, hash of the dictionary, one unused
+** integer) followed by the arrays:
+**
+**   double wt[nnz]       : the weight of each posting
+**   int    off[nord+1]   : the offset of the postings for each precursor ordinal (plus the end)
+**   int    word[nnz]     : the model number of each posting
+**   int    ord[nmod]     : the ordinal of the word for each model
+**   int    sz[nmod]      : the nominal size of the weights of each model
+*/
+
+#ifndef MMODEL_H
+#define MMODEL_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+#define MAP_MAGIC   "WMAP" // identifies a mapped model file
+#define MAP_VERSION 2      // the version of the mapped model file format
+
+class Mmodel {
+public:
+  Mmodel();                              // default constructor
+  ~Mmodel();                             // destructor (unmaps the file)
+  Mmodel(const Mmodel&) = delete;        // the mapping is not copyable
+  Mmodel& operator=(const Mmodel&) = delete;
+
+  bool   open(string);                   // maps a model file read-only
+  void   close(void);                    // unmaps the model file
+  bool   is_open(void) const;            // returns whether a model file is mapped
+  int    nord(void) const;               // gets the number of precursor ordinals
+  int    nmod(void) const;               // gets the number of models
+  int    npost(void) const;              // gets the number of postings
+  int    nvocab(void) const;             // gets the number of words in the dictionary it was made for
+  uint32_t vhash(void) const;            // gets the hash of the dictionary it was made for
+
+  const int*    off(void)  const { return poff;  } // the postings offsets (by ordinal)
+  const int*    word(void) const { return pword; } // the model number of each posting
+  const double* wt(void)   const { return pwt;   } // the weight of each posting
+  const int*    ord(void)  const { return pord;  } // the ordinal of each model
+  const int*    sz(void)   const { return psz;   } // the nominal size of each model
+
+  // writes a model file from the index arrays (to a temporary file that then replaces
+  // the old one, so that processes that have the old one mapped are not disturbed)
+  // write(path, off, word, wt, ord, sz, # of words, dictionary hash)
+  static bool write(string, const vector<int>&, const vector<int>&, const vector<double>&,
+                    const vector<int>&, const vector<int>&, int, uint32_t);
+
+private:
+  char         *base;                    // the start of the mapped file
+  size_t        len;                     // the length of the mapped file
+  vector<char>  buf;                     // the file contents when it cannot be mapped
+  int           no, nm, np;              // the number of ordinals, models and postings
+  int           nv;                      // the number of words in the dictionary
+  uint32_t      vh;                      // the hash of the dictionary
+  const int    *poff, *pword, *pord, *psz;
+  const double *pwt;
+};
+
+#endif // MMODEL_H
@@ -0,0 +1,48 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library provides the low-level numeric kernels used by the vector classes and the
+** logistic regression: dense element-by-element arithmetic, sums, a gather-based dot product
+** of a sparse vector against a dense array, and the exponential, logistic (sigmoid) and
+** log(1+exp(x)) functions applied to whole arrays, plus one byte kernel that maps text to
+** the character classes used by the tokenizer.  Each kernel has a plain scalar version
+** and, on x86-64 hosts built with gcc or clang, AVX2 and AVX-512 versions.  The instruction
+** set is chosen once at startup by asking the processor what it supports (CPUID), so the same
+** binary runs everywhere and uses the widest vectors available.
+*/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#define SIMD_SCALAR 0   // plain C++ loops
+#define SIMD_AVX2   1   // 256-bit vectors (4 doubles)
+#define SIMD_AVX512 2   // 512-bit vectors (8 doubles)
+
+int    simd_level(void);                                   // returns the instruction set in use
+int    simd_level(int);                                    // selects an instruction set (if supported)
+const char* simd_name(void);                               // returns the name of the instruction set
+
+double simd_sum(const double*, int);                       // returns the sum of an array
+double simd_dot(const double*, const double*, int);        // returns the sum of a[i]*b[i]
+void   simd_axpy(double, const double*, double*, int);     // y[i] += alpha*x[i]
+void   simd_scale(double*, double, int);                   // a[i] *= d
+void   simd_mul(double*, const double*, int);              // a[i] *= b[i]
+void   simd_add(double*, const double*, int);              // a[i] += b[i]
+void   simd_sub(double*, const double*, int);              // a[i] -= b[i]
+void   simd_threshold(double*, double, int);               // a[i] = (a[i] >= d) ? 1 : 0
+void   simd_exp(double*, int);                             // a[i] = exp(a[i])
+void   simd_sigmoid(double*, int);                         // a[i] = 1/(1+exp(-a[i]))
+void   simd_log1pexp(double*, int);                        // a[i] = log(1+exp(a[i]))
+double simd_gather_dot(const int*, const double*, int, const double*); // sum of v[k]*d[i[k]]
+void   simd_cmap(const char*, char*, int);                 // maps text to character classes (see below)
+
+/*
+** The simd_cmap() kernel maps every byte to the character class used by the tokenizer: the
+** lower case form of a letter (A-Z and Latin-1 192-222 are shifted down by 32; a-z and 223
+** and up are kept), an apostrophe (39), a space (32) for any whitespace, or zero for any
+** other character, which separates words.  The byte-wide kernels are AVX2 only (the AVX-512
+** table uses them too, since AVX-512 without the byte extensions has no byte operations).
+*/
+
+#endif // SIMD_H
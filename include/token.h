@@ -0,0 +1,64 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library implements a streaming tokenizer (Tokenizer) that splits a text file (or a
+** string) into the words used to build and test the dictionary.  The file is read through a
+** large buffer, and each word is normalized straight out of the buffer into storage that is
+** reused from one word to the next, so no memory is allocated per word.
+**
+** The words follow the same rules that were always used: the text is split at whitespace,
+** then cleanword() lowercases each piece (including the Latin-1 upper case letters), keeps
+** apostrophes that are inside the piece, and turns everything else into a separator.  Each
+** run of kept characters is a word, except that an apostrophe at the start or the end of a
+** word is replaced by a space (the second cleanword() pass that the old parser applied to
+** the training text did this).  The text that a model is tested against only ever had the
+** first pass, so that rule can be turned off when the Tokenizer is constructed.
+*/
+
+#ifndef TOKEN_H
+#define TOKEN_H
+
+#include <fstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define TOKBUF 1048576 // the size of the tokenizer read buffer (bytes)
+
+void cleanword(const char*, int, string&); // normalizes one whitespace-delimited piece of text
+void cleanmap(const char*, int, string&);  // the same, for text already mapped by simd_cmap()
+
+class Tokenizer {
+public:
+  Tokenizer(bool=true);            // default constructor (nothing to read; the flag turns the
+                                   // apostrophe rule of the second cleanword() pass on or off)
+  ~Tokenizer();                    // destructor (closes the file)
+
+  bool   open(const string&,int64_t=0,int64_t=-1); // starts reading words from a file (or part of one)
+  void   assign(const string&);    // starts reading words from a string
+  void   close(void);              // stops reading (closes the file)
+  bool   next(string&);            // gets the next word (returns false at the end)
+  bool   more(void) const;         // returns true if there may be more words to read
+  bool   inpiece(void) const;      // returns true if the piece of text of the last word has more words
+
+private:
+  void   fill(size_t);             // reads more of the file into the buffer (keeping the data from a position)
+  bool   piece(const char*&, int&); // finds the next whitespace-delimited piece of text
+
+  ifstream     ifile;              // the file being read
+  vector<char> buf;                // the read buffer
+  vector<char> cls;                // the character class of every character in the read buffer
+  size_t       pos;                // the position of the next unread character in the buffer
+  size_t       lim;                // the end of the valid data in the buffer
+  int64_t      left;               // the number of bytes left to read from the file (-1 = all)
+  bool         eof;                // flag indicating that the whole source is in the buffer
+  string       clean;              // the normalized form of the current piece
+  size_t       cp;                 // the position of the next word in the normalized piece
+  bool         edges;              // flag indicating whether an apostrophe at either end of a
+                                   // word becomes a space (the second cleanword() pass)
+};
+
+#endif // TOKEN_H
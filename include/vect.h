@@ -2,15 +2,16 @@
 ** Created by: Jason Orender
 ** (c) 2018 all rights reserved
 **
-** This library implements a sparse vector format (Svect) using the multiset standard container.
-** This container was chosen so that new elements could be added or subtracted with minimal cost,
-** since this will happen quite often as elements become zeroes and need to be eliminated from
-** explicit expression in the vector.  Most operations, since this is meant to facilitate
-** operations on sparse vectors, will be accomplished by using the cache system O(1) retrieval
-** time.  For vectors that have too many nonzero values (>64), the data can be retrieved in
-** O(log n) time since the multiset standard container is used.  A standard list would have
-** required O(n) time in these cases.  Of course if the size of the vector is known, and it
-** is relatively small and constant, using the Dvect class will work best since it is only 
+** This library implements a sparse vector format (Svect) using a pair of parallel contiguous
+** arrays: one holding the indices of the explicit (nonzero) elements in ascending order, and one
+** holding the corresponding values.  Keeping the explicit elements sorted and packed together
+** means that element-by-element operations between two sparse vectors (products, sums, dot
+** products) reduce to a single linear merge over both index arrays, which is far friendlier to
+** the cache than walking a tree of individually allocated nodes.  Random access to a single
+** element is done with a binary search in O(log n) time.  Inserting a new element in the middle
+** of the vector costs O(n), but in practice elements are almost always appended in index order
+** or the explicit set is small.  Of course if the size of the vector is known, and it is
+** relatively small and constant, using the Dvect class will work best since it is only 
 ** allocated once and elements can be accessed in O(1) time.
 */
 
@@ -19,51 +20,24 @@
 
 #include <iostream>
 #include <cmath>
-//#include <list>
-#include <set>
+#include <vector>
 #include <cstring>
 
 using namespace std;
 
-// cache size for Svect
-#define CSZ   64
 #define EPSIL 1E-08
-/*
-** Datapoint is a struct that contains the data for Svect.
-*/
-struct Datapoint {
-public:
-  Datapoint()                    { d = new double; *d = 0.0; } // default constructor initializes as zero
-  Datapoint(double f)            { d = new double; *d = f;   } // alternate constructor initializes with supplied value
-  Datapoint(const Datapoint& dp) { d = nullptr; copy(dp);    } // copy constructor
-  ~Datapoint()                   { delete d;                 } // destructor
-
-  Datapoint& operator=(const Datapoint& rhs) { copy(rhs); return *this; } 
-  void copy(const Datapoint &dp) 
-    { if (d != nullptr) delete d; d = new double; *d = *dp.d; i = dp.i; }
-
-  double *d;                        // the double precision element of the data
-  int    i;                         // the index of the data (like an array index)
-  
-};
 
-/*
-** The classcomp_dp structure compares two Datapoint instances for sorting purposes.  
-** This is the format that must be used for the multiset container declaration.
-*/
-struct classcomp_dp {
-  bool operator() (const Datapoint &lhs, const Datapoint &rhs) const
-  { return (lhs.i < rhs.i); }
-};
+class Dvect;
 
 /*
-** Svect is a class set up to store and manipulate a Datapoint vector.
+** Svect is a class set up to store and manipulate a sparse vector.
 */
 class Svect {
 public:
   Svect();                           // default constructor
   Svect(int);                        // alternate constructor
   Svect(const Svect&);               // copy constructor
+  Svect(Svect&&) noexcept;           // move constructor
   ~Svect();                          // destructor
 
   double  element(int) const;        // gets the value of a specific element in the vector
@@ -71,7 +45,6 @@ public:
   void    setall(double);            // sets all elements of a vector to the argument value
   void    set_explicit(double);      // sets all EXPLICIT elements of a vector to the argument value
   void    sete(int,double);          // sets a specific element to the argument value
-  void    sete(multiset<Datapoint>::iterator&, double);
   int     size(void) const;          // gets the size of the vector
 
   Svect& operator*=(const double);   // multiplies the vector by a constant
@@ -83,8 +56,13 @@ public:
   Svect& operator-=(const Svect&);   // subtracts another vector element-by-element from this one  
   Svect& operator-=(const double);   // subtracts every EXPLICIT element by the rhs argument  
   Svect  operator-(const Svect&);    // subtracts two vectors element-by-element
+  Svect& scale_add(double,const Svect&); // adds a scaled vector to this one in place
+  Svect& scale_add(double,const Dvect&); // adds a scaled dense vector to the EXPLICIT elements
+  void   scatter(Dvect&) const;         // copies the vector into a dense vector
+  void   gather(const Dvect&);          // sets the EXPLICIT elements from a dense vector
   Svect& operator=(const double);    // sets every EXPLICIT element of a vector to a specific value
   Svect& operator=(const Svect&);    // sets the elements to the same as those of another
+  Svect& operator=(Svect&&) noexcept; // takes over the elements of another (no copying)
   double operator[](int) const;      // allows accessing an individual element via brackets
   double& operator[](int);           // allows setting an individual element via brackets
 
@@ -92,8 +70,9 @@ public:
   int    find(double) const;         // returns the index of the first element matching particular data
   bool   isvalid(void) const;        // checks each explicit element to determine if it is a valid number
   int    count_explicit(void) const; // returns the number of explicit entries in the list
+  int    index(int) const;           // returns the index of the k-th explicit element
+  double value(int) const;           // returns the value of the k-th explicit element
   void   remove(int);                // removes an explicit element (sets it to zero)
-  multiset<Datapoint>::iterator remove(multiset<Datapoint>::iterator&);
   bool   resize(int);                // discards the data and sets the vector size to a new value
   bool   upsize(int);                // sets a new value for the vector size but keeps the data
   bool   copy(const Svect&);         // copies the data from an input vector to this one
@@ -104,20 +83,30 @@ public:
   void   tag(int);                   // sets the tag
   int    tag(void);                  // gets the tag
 
+  friend class    Smat;
+  friend double   dot(const Svect&, const Svect&);   // returns the dot product of two vectors
+  friend void     axpy(double, const Svect&, Dvect&); // accumulates a scaled vector into a dense one
   friend ostream& operator<<(ostream&,const Svect&); // outputs all elements to a stream
   friend istream& operator>>(istream&, Svect&);      // inputs n elements from a stream
 
 private:
-  multiset<Datapoint,classcomp_dp> a;                // the multiset containing the data for the vector
-  int     sz;                                        // the size of the vector
-  // defining a cache for array-like access speeds for vectors that have fewer explicit elements
-  // than the size of the cache (storing the iterator to directly access the elements)
-  multiset<Datapoint>::iterator cache_it[CSZ];
-  int      cache_index[CSZ];                         // storing the index of the element in the vector
-  double*  cache_dp[CSZ];                            // storing a pointer to the data element
-  int      tag_;                                     // can be used to identify a specific Svect
+  int    locate(int,int=0) const;    // finds the array position of an index (or where it belongs)
+
+  vector<int>    idx;                // the indices of the explicit elements (ascending order)
+  vector<double> val;                // the values of the explicit elements (parallel to idx)
+  int     sz;                        // the size of the vector
+  int     tag_;                      // can be used to identify a specific Svect
 };
 
+// returns the dot product of two sparse vectors without creating any temporaries
+// dot(vector-1, vector-2)
+double   dot(const Svect&, const Svect&);
+
+// adds a scaled sparse vector to another vector in place (y += alpha*x)
+// axpy(alpha, x, y)
+void     axpy(double, const Svect&, Svect&);
+void     axpy(double, const Svect&, Dvect&);
+
 ostream& operator<<(ostream&, const Svect&);
 istream& operator>>(istream&, Svect&);
 
@@ -129,6 +118,7 @@ public:
   Dvect(void);                     // default constructor
   Dvect(int);                      // alternate constructor
   Dvect(const Dvect&);             // copy constructor
+  Dvect(Dvect&&) noexcept;         // move constructor
   ~Dvect();                        // destructor
 
   double element(int) const;       // gets the value of a specific element in the vector
@@ -146,6 +136,7 @@ public:
   Dvect  operator-(const Dvect&);  // subtracts two vectors element-by-element
   Dvect& operator=(const double);  // sets all elements of a vector to a specific value
   Dvect& operator=(const Dvect&);  // sets the elements to the same as those of another
+  Dvect& operator=(Dvect&&) noexcept; // takes over the elements of another (no copying)
   double operator[](int) const;    // allows accessing an individual element via brackets
   double& operator[](int);         // allows setting an individual element via brackets
 
@@ -153,8 +144,15 @@ public:
   bool   copy(const Dvect&);       // copies the data from an input vector to this one
   double sum(void);                // returns the summation of all elements of this vector
   void   exp_elem(void);           // takes the exponential function of every element
+  void   sigmoid_elem(void);       // takes the logistic function of every element
+  void   log1pexp_elem(void);      // takes log(1+exp(x)) of every element
   void   apply_threshold(double);  // sets values >= threshold to 1 and < threshold to 0
 
+  friend class   Svect;
+  friend class   Smat;
+  friend void     axpy(double, const Svect&, Dvect&); // accumulates a scaled vector into this one
+  friend double   dot(const Dvect&, const Dvect&);   // returns the dot product of two vectors
+  friend void     axpy(double, const Dvect&, Dvect&); // adds a scaled vector to another in place
   friend ostream& operator<<(ostream&,const Dvect&); // outputs all elements to a stream
   friend istream& operator>>(istream&, Dvect&);      // inputs n elements from a stream
 
@@ -163,5 +161,51 @@ private:
   int     sz;                      // the size of the vector
 };
 
+// returns the dot product of two dense vectors
+// dot(vector-1, vector-2)
+double   dot(const Dvect&, const Dvect&);
+
+// adds a scaled dense vector to another in place (y += alpha*x)
+// axpy(alpha, x, y)
+void     axpy(double, const Dvect&, Dvect&);
+
+/*
+** Smat is a class set up to store a sparse matrix in compressed sparse row (CSR) format.
+** The explicit elements of every row are packed one after another into a single pair of
+** column index and value arrays, and a third array holds the offset at which each row
+** starts.  Rows can only be appended, which is all that is needed to assemble a feature
+** matrix one example at a time, and reading through the rows in order is a single 
+** sequential pass over contiguous memory.
+*/
+class Smat {
+public:
+  Smat(void);                      // default constructor
+  Smat(int);                       // alternate constructor (sets the number of columns)
+
+  void   clear(int=0);             // discards all rows and sets the number of columns
+  void   add_row(const Svect&);    // appends a sparse vector as the next row
+  void   add_row(const int*,const double*,int); // appends a row given as sorted (column, value) arrays
+  int    rows(void) const;         // gets the number of rows
+  int    cols(void) const;         // gets the number of columns (nominal row size)
+  int    nnz(void) const;          // gets the number of explicit elements in the matrix
+  void   row(int,Svect&) const;    // copies a row into a sparse vector
+  void   pattern(Svect&) const;    // makes a vector with an explicit zero for every column used
+  void   compact(Smat&,vector<int>&) const; // renumbers the columns used to 0..k-1 in a copy
+  void   columns(int,vector<int>&) const;   // appends the column numbers used by a row
+  double dot(int,const Svect&) const;        // returns the dot product of a row with a vector
+  double dot(int,const Dvect&) const;        // returns the dot product of a row with a dense vector
+  void   axpy(int,double,Dvect&) const;      // adds a scaled row to a dense vector in place
+
+  friend ostream& operator<<(ostream&,const Smat&); // outputs all rows to a stream
+
+private:
+  vector<int>    off;              // the offset of the first element of each row (plus the end)
+  vector<int>    col;              // the column indices of the explicit elements (row by row)
+  vector<double> val;              // the values of the explicit elements (parallel to col)
+  int            nc;               // the number of columns
+};
+
+ostream& operator<<(ostream&, const Smat&);
+
 #endif // VECT_H
 
@@ -1,4 +1,6 @@
 #include <list>
+#include <vector>
+#include <random>
 #include <iomanip>
 
 #include "../include/vect.h"
@@ -6,42 +8,126 @@
 #ifndef WDATA_H
 #define WDATA_H
 
+#define NVEC 4     // the size of the word vector predecessor array (# of priors)
+#define PMAX 100   // the maximum number of positive examples used in a regression
+#define FMAX 500   // the maximum number of examples (positive and negative) used in a regression
+#define NEGRATIO 9 // the default number of negative examples drawn for each positive example
+#define NEGSEED  20180601 // the base seed of the negative example draws (plus the word ordinal)
+
+/*
+** The "Prec" struct is one record of a precursor example: the ordinal of a word in the
+** window of precursors and its position there (1 = oldest).  An example is always NVEC
+** records sorted by ordinal; the records that are not used have an ordinal of -1.
+*/
+struct Prec {
+  int ord;                      // the ordinal of the word (-1 = record not used)
+  int pos;                      // the position of the word in the window (1 = oldest)
+};
+
+void precursors(const int*, int, Prec*); // makes a precursor example from the ordinals of a window
+
+/*
+** The "Corpus" class records a text that was read for training once, as the stream of
+** the ordinals of its words.  The precursor example of a word is not stored anywhere;
+** it is made from the NVEC words before it in the stream whenever it is needed, so the
+** examples of any word can be reached by position.
+*/
+class Corpus {
+public:
+  Corpus(void);                 // default constructor (no words)
+
+  void   clear(void);           // discards all of the words
+  int    push(int);             // adds the ordinal of the next word (returns its position)
+  int    size(void) const;      // gets the number of words
+  int    operator[](int) const; // gets the ordinal of the word at a position
+  void   features(int,Prec*) const; // sets NVEC records to the precursor example of a position
+
+private:
+  vector<int> ords;             // the ordinal of each word, in the order read
+};
+
+/*
+** The "Pstore" class holds the precursor examples of a word as a posting list: the
+** position in the corpus of every occurrence of the word that has a full window of
+** precursors before it, in the order that they were read.  The examples are numbered
+** from the newest (0) back to the oldest, which is the order that they are used in the
+** logistic regressions.
+*/
+class Pstore {
+public:
+  Pstore(void);                 // default constructor (no examples)
+
+  void   clear(void);           // discards all of the examples
+  void   add(int);              // adds an example (by its position in the corpus)
+  int    size(void) const;      // gets the number of examples
+  bool   empty(void) const;     // returns whether there are no examples
+  int    operator[](int) const; // gets the position of an example (0 = newest)
+
+private:
+  vector<int> at;               // the position of each example (oldest first)
+};
+
+/*
+** The "Sampler" class draws the negative examples for a regression.  It holds the
+** position in the corpus of every example of the words in the training set, so an
+** example can be drawn uniformly from all of them in constant time (with replacement),
+** without walking the examples of any word.  The draws come from a generator supplied
+** by the caller, so that they do not depend on which thread makes them.  It also holds
+** the number of negative examples to draw for each positive example.
+*/
+class Sampler {
+public:
+  Sampler(void);                // default constructor (no examples, default ratio)
+
+  void   clear(void);           // discards all of the examples (the ratio is kept)
+  void   add(int);              // adds an example (by its position in the corpus)
+  int    size(void) const;      // gets the number of examples
+  void   ratio(int);            // sets the number of negative examples for each positive one
+  int    ratio(void) const;     // gets the number of negative examples for each positive one
+  void   draw(int,int,const Corpus&,Pstore&,mt19937&) const; // draws examples that are not of a word
+
+private:
+  vector<int> pool;             // the position of each example of the words in the training set
+  int         r;                // the number of negative examples for each positive one
+};
+
 /*
 ** The "wdata" struct contains all of the mutable data pertaining to a word vector.
-** any data contained in this structure is guaranteed not to affect the sort order
-** in the multiset (binary search tree) used to contain the dictionary of words
-** used in the data set.  It is dynamically allocated at the time of a wordvect
-** instance creation.
+** None of the data contained in this structure affects how the word is found in the
+** dictionary (by its text through the hash table, or by its ordinal), so it can be
+** changed after the word is added.  The precursor examples are kept as positions in
+** the corpus of the dictionary (a Pstore), not as copies of the precursor words.  It
+** is dynamically allocated at the time of a wordvect instance creation.
 */
 struct wdata {
 public:
   wdata(void);                  // default constructor
+  wdata(wdata&&);               // move constructor
   ~wdata(void);                 // destructor (does nothing)
 
   
+  wdata& operator=(wdata&&);    // move assignment (takes over the data of another instance)
   void clear(int=0);            // clear all data in the structure and specify Svect nominal size
   void copy(const wdata&);      // copy the data from one instance of the structure to another
-  void add(Svect&);             // add an example to the precursor data
-  Svect& front(void);           // access the front element in the precursor data
-  Svect& next(void);            // access the next element in the precursor data
+  void add(int);                // add an example (a position in the corpus) to the precursor data
   int    size(void);            // access the size of the precursor data
-  void incr(void);              // increment the usage count
+  void incr(int=1);             // increment the usage count (by one or by a given amount)
   int  count(void) const;       // return the usage count
   bool is_populated(void);      // returns whether the weights vector is populated
-  void init_weights(double);    // initializes the weights used for the logistic regression calculation
-  void init_logr(double,Svect*,Svect&);      // initializes the features array used in the logistic regression
-  void add_negs(list<Svect>&,Svect*,Svect&); // adds negative observation data to the features and observations
+  void init_weights(double,const Corpus&);  // initializes the weights used for the logistic regression calculation
+  void init_logr(double,const Corpus&,Smat&,Svect&,int=NEGRATIO); // initializes the features matrix used in the logistic regression
+  void add_negs(const Pstore&,const Corpus&,Smat&,Svect&); // adds negative observation data to the features and observations
   void disp_weights(void);      // displays the weights
   int  num_obs(void);           // displays the number of observations used (fmax)
   double find_prob(Svect&);     // given a vector of precursors, finding probability
                                 // that the word in this instance is the next one
+  double find_wTx(Svect&);      // given a vector of precursors, finding the weighted sum
 
-  list<Svect> prec;             // data set for precursors
-  list<Svect>::iterator lit;    // the persistent list iterator
+  Pstore      prec;             // data set for precursors
   int         ct;               // usage count
   int         sz;               // nominal size of the sparse vectors
-  int         fmax;             // max size of the features vector (set to 10x prec size)
-  int         fsize;            // current size of the features vector
+  int         fmax;             // max number of examples in the features (set from the negative ratio)
+  int         fsize;            // current number of examples in the features
   bool        populated;        // flag indicating whether the weights have been populated
   double      thr;              // threshold value calculated from ROC curve
   Svect       weights;          // the weights calculated via logistic regession for predicting
@@ -0,0 +1,38 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library implements the sliding window of precursor words (Window) used when a text is
+** read for training or testing.  The window holds the ordinals of the last NVEC words in a
+** fixed ring buffer, so adding a word is a couple of integer operations, and the precursor
+** vector for the next word is built from those few ordinals directly: each word in the window
+** scores its position (1 for the oldest up to NVEC for the newest), and a word that appears
+** more than once scores its newest position.  Words that are not in the dictionary (ordinal
+** -1) take up a position but are not part of the precursor vector.
+*/
+
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include "../include/vect.h"
+#include "../include/dict.h"
+
+using namespace std;
+
+class Window {
+public:
+  Window();                        // default constructor (empty window)
+
+  void   clear(void);              // empties the window
+  void   push(int);                // adds the ordinal of the next word (the oldest drops out when full)
+  int    count(void) const;        // gets the number of words in the window
+  void   features(Prec*) const;    // sets NVEC records to the precursor example for the window
+  void   features(Svect&) const;   // sets a vector to the precursor vector for the window
+
+private:
+  int    ords[NVEC];               // the ordinals of the words in the window (a ring buffer)
+  int    head;                     // the position of the oldest word in the ring buffer
+  int    n;                        // the number of words in the window
+};
+
+#endif // WINDOW_H
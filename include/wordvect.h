@@ -1,4 +1,5 @@
 #include <cstdint>
+#include <set>
 
 #include "../include/wdata.h"
 
@@ -25,20 +26,35 @@ union outint { char c[4]; int32_t i; };
 #define PLATFORM LINUX
 #define IS_PLATFORM(A) (PLATFORM==A)
 
+/*
+** The WVit type definition saves considerable typing and reduces apparent complexity.
+** It is a pointer to a word in a dictionary, which stays valid as long as the word is
+** in the dictionary.  It must be kept in mind that the word is treated as const.  Any
+** attempt to access a member function of a wordvect that is not const will cause a
+** compile-time error.  For this reason, the "wdata" substruct is created as a dynamic
+** pointer within the wordvect.  The pointer to the wdata must be retrieved and set to
+** a temp variable that is not subject to the same restrictions.
+*/
+struct wordvect;
+struct solver_opts;
+typedef const wordvect* WVit;
+
 /*
 ** The "wordvect" structure stores the word vector and associated data.  Once the
 ** wordvect is written to the dictionary, the only data that is allowed to be
 ** changed is the data contained in the "wdata" substructure.  This guarantees
-** that the sort order of the multiset is never affected by updates.
+** that the key of the word in the dictionary is never affected by updates.
 */
 struct wordvect {
 public:
   wordvect(void);                         // default constructor (makes an empty instance)
   wordvect(string);                       // alternate constructor (initializes the string entry)
   wordvect(const wordvect&);              // copy constructor
+  wordvect(wordvect&&) noexcept;          // move constructor
   ~wordvect();                            // destructor
 
   wordvect& operator=(const wordvect&);   // assignment operator
+  wordvect& operator=(wordvect&&) noexcept; // move assignment operator
   wordvect& operator=(const string&);     // assignment operator
   bool      operator==(const string&);    // equivalence operator
   bool      operator==(const wordvect&);  // equivalence operator
@@ -49,23 +65,26 @@ public:
   bool   comp(const wordvect&) const;     // compares two wordvect instances 
   bool   comp(const string&) const;       // compares a string to the string data of this instance
   void   clear(void);                     // clears all data in a wordvect instance
-  string str(void) const;                 // returns the string entry
+  const string& str(void) const;          // returns the string entry
   void   incr(void);                      // increments the usage counter
   int    count(void) const;               // returns the usage count of the word
   int    num_obs(void) const;             // returns the number of observations expected
   void   setord(int);                     // sets the ordinal of the word
   int    getord(void) const;              // gets the ordinal of the word
-  void   addprec(Svect&) const;           // adds a precursor vector to the word data
-  void   set_train(list<multiset<wordvect>::iterator>*); // sets the pointer to the training set
-  void   set_test(list<multiset<wordvect>::iterator>*);  // sets the pointer to the testing set
+  void   addprec(int) const;              // adds a precursor example (a corpus position) to the word data
+  void   set_train(list<WVit>*);          // sets the pointer to the training set
+  void   set_test(list<WVit>*);           // sets the pointer to the testing set
+  void   set_corpus(const Corpus*);       // sets the pointer to the corpus that the examples are in
+  void   set_sampler(const Sampler*);     // sets the pointer to the sampler of negative examples
+  void   set_solver(const solver_opts*);  // sets the pointer to the solver settings
   void   solve(double, bool=false) const; // master function that solves for the weights
   bool   isvalid(void) const;             // checks to ensure that all of the weights are valid numbers
   double find_optimal(void) const;        // find the optimal threshold
   void   testsoln(void) const;            // benchmarks the solution against the test data
   double find_prob(Svect&) const;         // given a vector of precursors, finding probability
                                           // that the word in this instance is the next one
-  bool   write(bool=true) const;          // writes the data to an eponymous file
-  bool   read(bool=true) const;           // reads the data from an eponymous file
+  double find_wTx(Svect&) const;          // given a vector of precursors, finding the weighted sum
+  bool   read(bool=true) const;           // reads the data from an eponymous (legacy) file
 
   // Once a wordvect instance is stored in the dictionary, the only
   // way to change the substructure data is to explicitly set the
@@ -78,22 +97,17 @@ public:
   friend ostream& operator<<(ostream&,const wordvect&);
 
 private:
-  list<multiset<wordvect>::iterator> *train; // pointer to the training set for a dictionary
-  list<multiset<wordvect>::iterator> *test;  // pointer to the testing set for a dictionary
+  int    negratio(void) const;            // gets the number of negative examples for each positive one
+
+  list<WVit> *train; // pointer to the training set for a dictionary
+  list<WVit> *test;  // pointer to the testing set for a dictionary
+  const Corpus *corpus; // pointer to the corpus of a dictionary (the examples are made from it)
+  const Sampler *negs;  // pointer to the sampler of negative examples for a dictionary
+  const solver_opts *opts; // pointer to the solver settings for a dictionary
   string entry;      // the string data for this word
   Svect  empty_vec;  // an empty vector used to fill in
   int    ord;        // the ordinal number of a wordvect instance
   wdata  *wd;        // extra data on this word stored in a substructure
 };  
 
-/*
-** The WVit type definition saves considerable typing and reduces apparent complexity.
-** It must be kept in mind that this iterator is treated as const.  Any attempt to
-** access a member function of a wordvect that is not const will cause a compile-time
-** error.  For this reason, the "wdata" substruct is created as a dynamic pointer
-** within the wordvect.  The pointer to the wdata must be retrieved and set to a temp
-** variable that is not subject to the same restrictions.
-*/
-typedef multiset<wordvect>::iterator WVit;
-
 #endif // WORDVECT_H
\ No newline at end of file
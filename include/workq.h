@@ -0,0 +1,37 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library implements a simple pool of worker threads (Workq).  The pool is given a job
+** function, which every worker calls over and over until it returns false (meaning there is
+** no work left).  The job function is responsible for pulling its own work from a shared
+** source, so it has to lock whatever data it shares with the other workers.  Each worker
+** gets its own pseudorandom sequence (see RAND).  The seeds are handed out by the pool, so
+** the sequences are the same from one program run to the next, but every run of a job (and
+** every worker in it) gets a new one.
+*/
+
+#ifndef WORKQ_H
+#define WORKQ_H
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+class Workq {
+public:
+  Workq(int=0);                    // constructor (0 = one worker per hardware thread)
+
+  void   workers(int);             // sets the number of worker threads
+  int    workers(void) const;      // gets the number of worker threads
+  void   run(function<bool(int)>); // runs the job on every worker until it returns false
+
+private:
+  int    nw;                       // the number of worker threads
+  unsigned seed;                   // the seed for the RAND engine of the next worker started
+};
+
+#endif // WORKQ_H
@@ -27,6 +27,7 @@ int xmat_split(Datamodule &inputDS, double fract1, Datamodule &out1DS,
   int    nsize;   // size of input
   int    i, j, k; // counters
   double d;       // discriminator
+  Svect  xrow;    // temp variable for copying a row of the features
 
   // random number generator
   default_random_engine generator; 
@@ -37,8 +38,8 @@ int xmat_split(Datamodule &inputDS, double fract1, Datamodule &out1DS,
 	n1     = (int)(fract1 * nsize);
 	n2     = (int)(nsize - n1);
 
-	out1DS.xvec = new Svect[n1];
-	out2DS.xvec = new Svect[n2];
+	out1DS.xvec = new Smat(inputDS.xvec->cols());
+	out2DS.xvec = new Smat(inputDS.xvec->cols());
 	out1DS.yvec.resize(n1);
 	out2DS.yvec.resize(n2);
 	out1DS.wvec = inputDS.wvec;
@@ -47,10 +48,11 @@ int xmat_split(Datamodule &inputDS, double fract1, Datamodule &out1DS,
 	j = k = 0;
 	for (int i=0; i < nsize; i++) {
 	  d = distrib(generator);
+	  inputDS.xvec->row(i, xrow);
 	  if ((d < fract1) && (j < n1)) 
-		{ out1DS.xvec[j] = inputDS.xvec[i]; out1DS.yvec[j] = inputDS.yvec[i]; j++; }
+		{ out1DS.xvec->add_row(xrow); out1DS.yvec[j] = inputDS.yvec[i]; j++; }
 	  else 
-		{ out2DS.xvec[k] = inputDS.xvec[i]; out2DS.yvec[k] = inputDS.yvec[i]; k++; }
+		{ out2DS.xvec->add_row(xrow); out2DS.yvec[k] = inputDS.yvec[i]; k++; }
 	} // end for loop (i)
 
   } // end if (fract1) 
@@ -67,20 +69,22 @@ int xmat_split(Datamodule &inputDS, double fract1, Datamodule &out1DS,
 /*
 ** Calculate the components of the Log Liklihood (LL) objective function.
 */
-void LLcomp(Svect &l, Svect &w, Svect &y, Svect *x) {
-  double wTx, a, b;
+void LLcomp(Svect &l, Svect &w, Svect &y, Smat *x) {
+  Dvect wd(w.size()), z(y.size()), s(y.size());
+
+  w.scatter(wd);
+  for (int i=0; i<z.size(); i++) z[i] = x->dot(i, wd);
+  s.copy(z);
+  s.log1pexp_elem();
 
   l.resize(y.size());
-  for (int i=0; i<l.size(); i++) {
-    wTx  = (w * x[i]).sum();
-    l[i] = y[i] * wTx - log(1 + exp(wTx));
-  }
+  for (int i=0; i<l.size(); i++) l[i] = y[i] * z[i] - s[i];
 }
 
 /*
 ** The Log Liklihood (LL) objective function.
 */
-double LL(Svect &w, Svect &y, Svect *x) {
+double LL(Svect &w, Svect &y, Smat *x) {
   Svect ret;
   LLcomp(ret, w, y, x);
   return ret.sum();
@@ -93,44 +97,392 @@ double LL(Svect &w, Svect &y, Svect *x) {
 */
 
 Datamodule::Datamodule() {
-  xvec = nullptr;
+  xvec   = nullptr;
+  sx     = nullptr;
+  dense  = true;
+  lambda = 0.0;
 } // end Datamodule()
 
 Datamodule::~Datamodule () {
 } // end ~Datamodule()
 
 /*
-** The getsoln() function iterates to a solution until either the objective
-** function change from one iteration to the next is less than espsilon, or the
-** max number of iterations is reached.
+** The solver_opts constructor sets the default solver settings.
 */
-int Datamodule::getsoln(double epsilon, int maxiter) {
-  int    i=0;           // counter
+solver_opts::solver_opts(void) {
+  method  = SOLVER_LBFGS;
+  maxiter = 200;
+  epsilon = 1E-07;
+  gtol    = 1E-05;
+  lambda  = 1.0;
+  history = 8;
+  cgiter  = 50;
+  batch   = 32;
+  rate    = 0.0;
+  decay   = 0.01;
+} // end solver_opts()
+
+/*
+** The getsoln() function iterates to the weights that maximize the log-liklihood
+** (less the L2 penalty) using the optimizer chosen in the options, and returns the
+** number of iterations used.  The optimizers all work on a dense copy of the 
+** weights, so each w.x product is a gather over the row, and wTx is found for 
+** every example first so that the logistic function and the log-liklihood terms
+** can be computed for the whole batch with the vector kernels.  In dense mode (the
+** default) the features are first copied with the columns that are actually used
+** renumbered 0..k-1, so the weights, the gradient and all of the other working
+** vectors are arrays of k elements instead of the nominal vector size.  The 
+** weights vector is given an explicit element for every feature used and is 
+** sparse again once the solution is found.
+*/
+int Datamodule::getsoln(const solver_opts &opts) {
+  int    niter = 0;     // number of iterations
   int    szw;           // the size of the w vector
-  double ll, ll_old;    // objective function values
-  double wTx, f;
-  double alpha = 0.001; // speed at which to converge using the gradient
-  Svect  dk;            // temp variable for the gradient
-
-  ll = ll_old = 0.0;
-  szw = wvec.size();
-  for (i=0; i<maxiter; i++) {
-    ll_old = ll;
-    // calculating the gradient of the logistic function
-    dk.resize(szw);
-    for (int i = 0; i < examples(); i++) {
-      wTx  = (wvec * xvec[i]).sum();
-      f    = exp(wTx)/(1+exp(wTx));
-      dk  += (xvec[i] * (yvec[i] - f));         // gradient update
-      ll  += yvec[i] * wTx - log(1 + exp(wTx)); // log-liklihood
+  int    n;             // the number of examples
+  Dvect  wd;            // dense copy of the weights
+  Svect  support;       // the pattern of every feature used in the examples
+  Smat   cx;            // the features with compacted column numbers (dense mode)
+  vector<int> cmap;     // the original column of each compacted column (dense mode)
+
+  n      = examples();
+  sx     = xvec;
+  lambda = opts.lambda;
+  yd.resize(n);
+  zd.resize(n);
+  sd.resize(n);
+  dd.resize(n);
+
+  // making sure that every feature has an explicit (possibly zero) weight so that 
+  // the solution can be copied back into the weights in place
+  xvec->pattern(support);
+  wvec += support;
+  if (dense) {
+    xvec->compact(cx, cmap);
+    sx  = &cx;
+    szw = cx.cols();
+    wd.resize(szw);
+    for (int j=0; j<szw; j++) wd[j] = wvec.element(cmap[j]);
+  }
+  else {
+    szw = wvec.size();
+    wd.resize(szw);
+    wvec.scatter(wd);
+  }
+  yvec.scatter(yd);
+
+  switch (opts.method) {
+  case SOLVER_GRADIENT: niter = solve_gradient(wd, opts); break;
+  case SOLVER_NEWTONCG: niter = solve_newtoncg(wd, opts); break;
+  case SOLVER_SGD:
+  case SOLVER_ADAGRAD:
+  case SOLVER_ADAM:     niter = solve_stochastic(wd, opts); break;
+  default:              niter = solve_lbfgs(wd, opts);    break;
+  } // end switch (method)
+
+  if (dense) { for (int j=0; j<szw; j++) wvec.sete(cmap[j], wd[j]); }
+  else       { wvec.gather(wd); }
+  sx = nullptr;
+  return niter;
+
+} // end getsoln()
+
+/*
+** The objective() function returns the function that the optimizers minimize at
+** the weights "w" (the negative of the log-liklihood plus the L2 penalty), and
+** calculates its gradient in "g".  The Hessian diagonal for each example is kept
+** for hessvec(), which uses the weights of the last call to this function.
+*/
+double Datamodule::objective(Dvect &w, Dvect &g) {
+  double f = 0.0;
+  int    n = yd.size();
+
+  for (int i=0; i<n; i++) {
+    zd[i] = sx->dot(i, w);
+    f    -= yd[i] * zd[i];
+  }
+  sd.copy(zd);
+  sd.log1pexp_elem();
+  f += sd.sum();
+  zd.sigmoid_elem();
+
+  g = 0.0;
+  for (int i=0; i<n; i++) {
+    sx->axpy(i, zd[i] - yd[i], g);
+    dd[i] = zd[i] * (1.0 - zd[i]);
+  }
+
+  f += 0.5 * lambda * dot(w, w);
+  axpy(lambda, w, g);
+  return f;
+} // end objective()
+
+/*
+** The hessvec() function multiplies the Hessian of the objective function by a
+** vector ("hv = H*v") without forming the Hessian: H = X'DX + lambda*I.
+*/
+void Datamodule::hessvec(Dvect &v, Dvect &hv) {
+  hv = 0.0;
+  for (int i=0; i<yd.size(); i++) sx->axpy(i, dd[i] * sx->dot(i, v), hv);
+  axpy(lambda, v, hv);
+} // end hessvec()
+
+/*
+** The linesearch() function looks for a step "t" along the direction "p" from
+** the weights "w" (where the objective is "f" and the gradient is "g") that
+** decreases the objective enough (the Armijo condition), halving the step each
+** time it does not.  The first step tried is the value of "t" on entry, and the
+** step taken is returned in it.  The new weights and gradient are left in "wn" 
+** and "gn" and the new objective is returned.  If no step decreases the
+** objective, "t" is set to zero and "f" is returned.
+*/
+double Datamodule::linesearch(Dvect &w, double f, Dvect &g, Dvect &p, double &t,
+                              Dvect &wn, Dvect &gn) {
+  double fn, gtp;
+
+  gtp = dot(g, p);
+  if (gtp >= 0.0) { p.copy(g); p *= -1.0; gtp = -dot(g, g); } // not downhill; use the gradient
+
+  for (int k=0; k<40; k++) {
+    wn.copy(w);
+    axpy(t, p, wn);
+    fn = objective(wn, gn);
+    if (fn <= f + 1E-04 * t * gtp) return fn;
+    t *= 0.5;
+  } // end for (k)
+
+  t = 0.0;
+  return f;
+} // end linesearch()
+
+/*
+** The converged() function returns whether the iterations can stop, given the
+** objective function before and after the last iteration and the gradient.
+*/
+bool Datamodule::converged(double fold, double f, Dvect &g, const solver_opts &opts) {
+  if (sqrt(dot(g, g)) < opts.gtol) return true;
+  return (fabs(fold - f) < opts.epsilon * max(1.0, fabs(f)));
+} // end converged()
+
+/*
+** The solve_gradient() function takes steps along the gradient, using a line 
+** search to find each step.  Each search starts at twice the last step taken.
+*/
+int Datamodule::solve_gradient(Dvect &w, const solver_opts &opts) {
+  int    i;
+  double f, fn, t;
+  Dvect  g(w.size()), gn(w.size()), wn(w.size()), p(w.size());
+
+  f = objective(w, g);
+  t = 1.0 / max(1.0, sqrt(dot(g, g)));
+  for (i=0; i<opts.maxiter; i++) {
+    if (sqrt(dot(g, g)) < opts.gtol) break;
+    p.copy(g);
+    p *= -1.0;
+    fn = linesearch(w, f, g, p, t, wn, gn);
+    if (t == 0.0) break;
+    swap(w, wn);
+    swap(g, gn);
+    if (converged(f, fn, g, opts)) { i++; break; }
+    f  = fn;
+    t *= 2.0;
+  } // end for (i)
+
+  return i;
+} // end solve_gradient()
+
+/*
+** The solve_lbfgs() function uses the limited memory BFGS method: the last few
+** changes in the weights (s) and the gradient (y) are kept and used to build an
+** approximation of the inverse Hessian times the gradient (the two-loop recursion),
+** which gives a step direction that is usually very good, so only a few dozen 
+** iterations are needed.  A pair is only kept if s'y is positive, which keeps the
+** approximation positive definite.
+*/
+int Datamodule::solve_lbfgs(Dvect &w, const solver_opts &opts) {
+  int    i, j, k, m, cnt = 0, head = 0;
+  double f, fn, t, sy, yy, gamma = 1.0, b;
+  Dvect  g(w.size()), gn(w.size()), wn(w.size()), p(w.size());
+
+  m = max(1, opts.history);
+  vector<Dvect>  S(m, Dvect(w.size())), Y(m, Dvect(w.size()));
+  vector<double> rho(m), a(m);
+
+  f = objective(w, g);
+  for (i=0; i<opts.maxiter; i++) {
+    if (sqrt(dot(g, g)) < opts.gtol) break;
+
+    // two-loop recursion (newest pair to oldest, then back again)
+    p.copy(g);
+    for (k=0; k<cnt; k++) {
+      j    = (head - 1 - k + m) % m;
+      a[j] = rho[j] * dot(S[j], p);
+      axpy(-a[j], Y[j], p);
+    }
+    p *= gamma;
+    for (k=cnt-1; k>=0; k--) {
+      j = (head - 1 - k + m) % m;
+      b = rho[j] * dot(Y[j], p);
+      axpy(a[j] - b, S[j], p);
+    }
+    p *= -1.0;
+
+    t  = (cnt == 0)?(1.0 / max(1.0, sqrt(dot(g, g)))):1.0;
+    fn = linesearch(w, f, g, p, t, wn, gn);
+    if (t == 0.0) break;
+
+    // storing the newest correction pair over the oldest one
+    S[head].copy(wn);  S[head] -= w;
+    Y[head].copy(gn);  Y[head] -= g;
+    sy = dot(S[head], Y[head]);
+    yy = dot(Y[head], Y[head]);
+    if (sy > 1E-10 * yy) {
+      rho[head] = 1.0 / sy;
+      gamma     = sy / yy;
+      head      = (head + 1) % m;
+      if (cnt < m) cnt++;
     }
 
-    if (fabs(ll_old-ll) < epsilon) break;
-    wvec += dk*alpha;
+    swap(w, wn);
+    swap(g, gn);
+    if (converged(f, fn, g, opts)) { i++; break; }
+    f = fn;
   } // end for (i)
+
   return i;
+} // end solve_lbfgs()
 
-} // end getsoln()
+/*
+** The solve_newtoncg() function uses Newton's method, where each step solves
+** H*p = -g with the conjugate gradient method using Hessian-vector products, so
+** the Hessian is never formed.  The solve is only as accurate as it needs to be
+** (the tolerance shrinks as the gradient does), and a line search protects 
+** against steps that are too long far from the solution.
+*/
+int Datamodule::solve_newtoncg(Dvect &w, const solver_opts &opts) {
+  int    i, k;
+  double f, fn, t, gn2, tol, rr, rrn, pHp, a;
+  Dvect  g(w.size()), gn(w.size()), wn(w.size()), p(w.size());
+  Dvect  r(w.size()), d(w.size()), hd(w.size());
+
+  f = objective(w, g);
+  for (i=0; i<opts.maxiter; i++) {
+    gn2 = sqrt(dot(g, g));
+    if (gn2 < opts.gtol) break;
+
+    // conjugate gradient solve of H*p = -g (starting from p = 0)
+    p   = 0.0;
+    r.copy(g);
+    r  *= -1.0;
+    d.copy(r);
+    rr  = dot(r, r);
+    tol = min(0.5, sqrt(gn2)) * gn2;
+    for (k=0; k<opts.cgiter; k++) {
+      hessvec(d, hd);
+      pHp = dot(d, hd);
+      if (pHp <= 0.0) break;
+      a = rr / pHp;
+      axpy(a, d, p);
+      axpy(-a, hd, r);
+      rrn = dot(r, r);
+      if (sqrt(rrn) < tol) break;
+      d  *= rrn / rr;
+      d  += r;
+      rr  = rrn;
+    } // end for (k)
+    if (dot(p, p) == 0.0) { p.copy(g); p *= -1.0; } // no curvature found; use the gradient
+
+    t  = 1.0;
+    fn = linesearch(w, f, g, p, t, wn, gn);
+    if (t == 0.0) break;
+    swap(w, wn);
+    swap(g, gn);
+    if (converged(f, fn, g, opts)) { i++; break; }
+    f = fn;
+  } // end for (i)
+
+  return i;
+} // end solve_newtoncg()
+
+/*
+** The solve_stochastic() function implements the mini-batch methods (SGD, Adagrad
+** and Adam).  Each epoch visits the examples in a new random order (a Fisher-Yates
+** shuffle drawn from RAND) and takes a step after every "batch" examples, using the
+** average gradient of the batch.  Only the weights whose features appear in the batch
+** are changed (along with their Adagrad/Adam state), so the cost of an epoch depends
+** on the number of examples and not on the number of weights.  A weight that is
+** changed picks up the share of the L2 penalty for every step since it was last
+** changed.  The full objective is evaluated once per epoch to test for convergence.
+*/
+int Datamodule::solve_stochastic(Dvect &w, const solver_opts &opts) {
+  const double beta1 = 0.9, beta2 = 0.999, eps = 1E-08; // Adam/Adagrad constants
+  int    e, i, j, c, b, n, bs, steps = 0;
+  double f, fn, rate, rate0, gc, p1 = 1.0, p2 = 1.0;
+  Dvect  g(w.size()), m(w.size()), v(w.size()), zb;
+  vector<int>  order, cols, last(w.size(), 0);
+  vector<char> mark(w.size(), 0);
+
+  n  = yd.size();
+  bs = max(1, min(opts.batch, n));
+  zb.resize(bs);
+  order.resize(n);
+  for (i=0; i<n; i++) order[i] = i;
+  rate0 = opts.rate;
+  if (rate0 <= 0.0) rate0 = (opts.method == SOLVER_ADAM)?0.05:0.5;
+
+  f = objective(w, g);
+  g = 0.0;
+  for (e=0; e<opts.maxiter; e++) {
+    // shuffling the examples for this epoch
+    for (i=n-1; i>0; i--) { j = (int)(RAND * (i+1)); swap(order[i], order[j]); }
+    rate = rate0 / (1.0 + opts.decay * e);
+
+    for (b=0; b<n; b+=bs) {
+      // the logistic function for every example in the batch, then its gradient
+      zb = 0.0;
+      for (i=b; (i<b+bs) && (i<n); i++) zb[i-b] = sx->dot(order[i], w);
+      zb.sigmoid_elem();
+      cols.clear();
+      for (i=b; (i<b+bs) && (i<n); i++) {
+        sx->axpy(order[i], zb[i-b] - yd[order[i]], g);
+        sx->columns(order[i], cols);
+      }
+
+      // updating only the weights that the batch touched
+      steps++;
+      p1 *= beta1;
+      p2 *= beta2;
+      for (j=0; j<(int)cols.size(); j++) {
+        c = cols[j];
+        if (mark[c]) continue;
+        mark[c] = 1;
+        gc = g[c] / min(bs, n-b) + (lambda / n) * (steps - last[c]) * w[c];
+        last[c] = steps;
+        switch (opts.method) {
+        case SOLVER_ADAGRAD:
+          v[c] += gc * gc;
+          w[c] -= rate * gc / (sqrt(v[c]) + eps);
+          break;
+        case SOLVER_ADAM:
+          m[c]  = beta1 * m[c] + (1.0 - beta1) * gc;
+          v[c]  = beta2 * v[c] + (1.0 - beta2) * gc * gc;
+          w[c] -= rate * (m[c] / (1.0 - p1)) / (sqrt(v[c] / (1.0 - p2)) + eps);
+          break;
+        default:
+          w[c] -= rate * gc;
+          break;
+        } // end switch (method)
+      } // end for (j)
+      for (j=0; j<(int)cols.size(); j++) { g[cols[j]] = 0.0; mark[cols[j]] = 0; }
+    } // end for (b)
+
+    fn = objective(w, g);
+    if (converged(f, fn, g, opts)) { e++; break; }
+    f = fn;
+    g = 0.0;
+  } // end for (e)
+
+  return e;
+} // end solve_stochastic()
 
 /*
 ** The gen_conf_matrix() function calculates and displays (to stdout) a
@@ -164,6 +516,7 @@ void Datamodule::calc_conf(double *results) {
 bool Datamodule::read_input(char **argc, bool verbose) {
   ifstream infile;
   int      nFeatures, nExamples;
+  Svect    xrow;
 
   // reading in initial weights file
   infile.open(argc[1]);
@@ -173,8 +526,7 @@ bool Datamodule::read_input(char **argc, bool verbose) {
   	infile >> nFeatures >> nExamples;
     cout << "  (" << nFeatures << " features, " 
       << nExamples << " examples)" << endl;
-  	xvec = new Svect[nExamples];
-    for (int i=0; i<nExamples; i++) xvec[i].resize(nFeatures);
+  	xvec = new Smat(nFeatures);
     wvec.resize(nFeatures);
     yvec.resize(nExamples);
 
@@ -190,12 +542,16 @@ bool Datamodule::read_input(char **argc, bool verbose) {
 
 	  infile.open(argc[3]);
 	  if (infile.is_open()) {
-		for (int i=0; i<nExamples; i++) infile >> xvec[i];
+		for (int i=0; i<nExamples; i++) { 
+		  xrow.resize(nFeatures); 
+		  infile >> xrow; 
+		  xvec->add_row(xrow); 
+		}
 		infile.close();
 		if (verbose) cout << "Features:" << endl;
 		if (verbose) 
 		  for (int i=0; i<nExamples; i++) 
-			cout << setw(5) << i << ": " << xvec[i] << endl;
+			{ xvec->row(i, xrow); cout << setw(5) << i << ": " << xrow << endl; }
 		}
 	  else 
 		{ cerr << "Bad input file name (x-data)." << endl; return false; }
@@ -252,13 +608,19 @@ void Datamodule::set_weights(Svect &w) { wvec = w; }
 /*
 ** Set the features pointer to an externally supplied value.
 */
-void Datamodule::set_features(Svect *f) { xvec = f; }
+void Datamodule::set_features(Smat *f) { xvec = f; }
 
 /*
 ** Set the observations from an externally supplied vector.
 */
 void Datamodule::set_observations(Svect &o) { yvec = o; }
 
+/*
+** Set whether the solution is found using compacted dense weights (the
+** default) or dense weights of the nominal vector size.
+*/
+void Datamodule::set_dense(bool d) { dense = d; }
+
 /*
 ** Get the weights that were calculated.
 */
@@ -268,15 +630,15 @@ void Datamodule::get_weights(Svect &w) { w = wvec; }
 ** The predictive function. "y" is the output in this case.
 */
 void Datamodule::pred(void) {
-  double wTx;
+  Dvect wd(wvec.size()), z(yvec.size());
 
   tvec.resize(0);
   rvec.resize(yvec.size());
 
-  for (int i=0; i<yvec.size(); i++) {
-    wTx  = (wvec * xvec[i]).sum();
-    rvec[i] = exp(wTx)/(1 + exp(wTx));
-  }
+  wvec.scatter(wd);
+  for (int i=0; i<z.size(); i++) z[i] = xvec->dot(i, wd);
+  z.sigmoid_elem();
+  for (int i=0; i<z.size(); i++) rvec[i] = z[i];
 }
 
 /*
@@ -316,8 +678,7 @@ void Datamodule::display_observations(void) {
 void Datamodule::display_features(int dec) {
   cout << setprecision(dec) << fixed;
   cout << endl << "Features:" << endl;
-  for (int i=0; i<yvec.size(); i++)
-    cout << xvec[i] << endl;
+  cout << *xvec;
   cout << endl;
 } // end display_features()
 
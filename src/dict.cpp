@@ -4,13 +4,26 @@
 /*
 ** These definitions of the random engine and distribution are used as
 ** components of the RAND macro to generate a random number in the
-** semi-open range [0,1).
+** semi-open range [0,1).  There is one copy per thread.
 */
-default_random_engine             rand_gen; 
-uniform_real_distribution<double> rand_distr(0.0,1.0);
+thread_local default_random_engine             rand_gen; 
+thread_local uniform_real_distribution<double> rand_distr(0.0,1.0);
 
 using namespace std;
 
+/*
+** The byname() function is a comparator function for sorting words by their
+** text, and the hashstr() function is the hash function (32-bit FNV-1a) used
+** for the hash table of the dictionary.
+*/
+bool byname(WVit first, WVit second) { return first->comp(*second); }
+
+uint32_t hashstr(const string &sw) {
+  uint32_t h = 2166136261u;
+  for (size_t k=0; k<sw.length(); k++) { h ^= (unsigned char)sw[k]; h *= 16777619u; }
+  return h;
+}
+
 /*
 ******************************************************************************
 ************************** Friend Functions HERE *****************************
@@ -23,12 +36,14 @@ using namespace std;
 */
 ostream& operator<<(ostream& os, const Dict& d) {
   list<WVit>::const_iterator lit;
-  WVit it = d.words.end();
+  vector<WVit>               sorted;
+
+  // the words are shown in reverse alphabetical order
+  for (int k=0; k<(int)d.words.size(); k++) sorted.push_back(&d.words[k]);
+  sort(sorted.begin(), sorted.end(), byname);
   os << "dict: [ ";
-  do { 
-    it--; 
-    if ((*it).count() > d.thr) os << *it << " "; 
-  } while (it != d.words.begin());
+  for (int k=(int)sorted.size()-1; k>=0; k--) 
+    if (sorted[k]->count() > d.thr) os << *sorted[k] << " "; 
   os << "] " << "<" << d.words.size() << ">" << endl << endl;
 
   os << "test: [ ";
@@ -64,8 +79,8 @@ bool byfreq(WVit first, WVit second) {
 */
 Dict::Dict() { clear(); loadnix("nixlist.txt","standardlist.txt"); }
 /*
-** Destructor (does nothing - there is no dynamic data other than the multiset
-** which has its own destructor).
+** Destructor (does nothing - there is no dynamic data other than the containers
+** which have their own destructors).
 */
 Dict::~Dict() { }
 
@@ -74,16 +89,25 @@ Dict::~Dict() { }
 ** currently residing in the dictionary is lost.
 */
 void Dict::clear(void) {
+  Hslot none = { 0, -1 };
+
   empty.setord(-1);
   empty = "@";
   nord = 0;
   thr = 0;
   ptrain = 0.18;
   ptest  = 0.18;
-  words.erase(words.begin(),words.end());
+  words.clear();
+  slots.assign(HMIN, none);
+  byord.clear();
+  intrain.clear();
+  corpus.clear();
+  negs.clear();
   train.erase(train.begin(),train.end());
   test.erase(test.begin(),test.end());
   prioritized = false;
+  indexed = false;
+  mm.close();
 }
 
 /*
@@ -93,89 +117,207 @@ void Dict::clear(void) {
 */
 void Dict::thresh(int t) { thr = t; }
 
+/*
+** The negratio() functions set and get the number of negative examples drawn for
+** each positive example when a regression is calculated (NEGRATIO by default).
+*/
+void Dict::negratio(int n)      { negs.ratio(n);      }
+int  Dict::negratio(void) const { return negs.ratio(); }
+
+/*
+** The solver() functions set and get the method that the weights of a regression are
+** solved with (SOLVER_LBFGS by default).  An unknown method is ignored.
+*/
+void Dict::solver(int m) {
+  if ((m >= SOLVER_GRADIENT) && (m <= SOLVER_ADAM)) sopts.method = m;
+} // end solver()
+
+int Dict::solver(void) const { return sopts.method; }
+
 /*
 ** The addword() functions add a wordvect to the dictionary if it does not 
 ** already exist or increments the usage counter if it does already exist.  
 ** Returns TRUE if the wordvect was required to be added to the dictionary, 
-** and FALSE if it was already in the dictionary.
+** and FALSE if it was already in the dictionary.  The first version copies
+** the supplied wordvect into the dictionary, while the second takes it over
+** (it must not be used afterwards).
 */
 bool Dict::addword(wordvect &w, bool neword) {
-  WVit      it;
-  double    d;
-  wdata    *wd;            // temp variable to avoid triggering const violation
+  wordvect temp(w);
+  return addword(std::move(temp), neword);
+}
+bool Dict::addword(wordvect &&w, bool neword) {
+  uint32_t  h;
+  int       s;
 
   prioritized = false;     // makes any existing prioritization invalid
-  it = words.find(w);
-  if (it == words.end()) { // add a new record if an existing one was not found
-    w.incr();
-    if (neword) w.setord(nord++);
-    w.set_train(&train);
-    w.set_test(&test);
-    it = words.insert(w);
-    // there is a certain small chance that a newly created entry will also be
-    // added to either the training or the testing data set (but not both)
-    d = RAND;
-    if      (d < ptrain)         train.push_front(it);
-    else if (d < (ptrain+ptest)) test.push_front(it);
+  h = hashstr(w.str());
+  s = probe(w.str(), h);
+  if (slots[s].o < 0) {   // add a new record if an existing one was not found
+    insert(std::move(w), h, s, neword);
     return true;           // return true if a new record was added
   }
   else {                   // increment record count if an existing one was found
-    wd = (*it).word_data();
-    wd->incr();
+    byord[slots[s].o]->word_data()->incr();
     return false;          // return false if matching record already present
   }
 
 }
-// create a a wordvect from a supplied string, and then add it to the dictionary
-bool Dict::addword(string sw) {
-  wordvect w(sw);
-  if (sw == "") return false;
-  else          return addword(w);
+// add a word given by its string (a wordvect is only built if the word is new;
+// otherwise its count is incremented here); the count given is the number of 
+// occurrences of the word being added at once.  The word is only looked up once,
+// and the entry that it was found at (or added at) is returned, so that the
+// caller does not have to look it up again (an empty word is not added, and the
+// "empty" entry is returned for it).
+WVit Dict::addword(const string &sw, int n) {
+  WVit     it;
+  uint32_t h;
+  int      s;
+
+  if (sw == "") return &empty;
+  prioritized = false;     // (the counts determine the priority)
+  h = hashstr(sw);
+  s = probe(sw, h);
+  if (slots[s].o < 0) {
+    it = insert(wordvect(sw), h, s, true);
+    if (n > 1) it->word_data()->incr(n - 1);
+    return it;
+  } // end if (slots)
+  it = byord[slots[s].o];
+  it->word_data()->incr(n);
+  return it;
 }
 
+/*
+** The insert() function adds a new word to the dictionary at the empty hash table
+** slot given (found by probe() with the hash given), with a count of one, and 
+** returns its entry.  The word gets the next ordinal unless it already has one and
+** "neword" is false.  There is a certain small chance that a newly created entry 
+** will also be added to either the training or the testing data set (but not both).
+*/
+WVit Dict::insert(wordvect &&w, uint32_t h, int s, bool neword) {
+  WVit   it;
+  double d;
+
+  prioritized = false;     // makes any existing prioritization invalid
+  indexed = false;         // and the inverted precursor index
+  w.incr();
+  if (neword || (w.getord() < 0)) w.setord(nord++);
+  w.set_train(&train);
+  w.set_test(&test);
+  w.set_corpus(&corpus);
+  w.set_sampler(&negs);
+  w.set_solver(&sopts);
+  words.push_back(std::move(w));
+  it = &words.back();
+  if (it->getord() >= (int)byord.size()) {
+    byord.resize(it->getord() + 1, &empty);
+    intrain.resize(it->getord() + 1, 0);
+  } // end if (byord)
+  byord[it->getord()] = it;
+  slots[s].h = h;
+  slots[s].o = it->getord();
+  if (2 * (int)words.size() > (int)slots.size()) rehash(2 * slots.size());
+  d = RAND;
+  if      (d < ptrain)         { train.push_front(it); intrain[it->getord()] = 1; }
+  else if (d < (ptrain+ptest)) test.push_front(it);
+  return it;
+} // end insert()
+
+/*
+** The addtoken() function records the next word of the text being read for training
+** in the corpus.  Once there are NVEC words before it, the position of the word in
+** the corpus is added to its precursor data (the words before it are the example),
+** and also to the examples that negative examples are drawn from if the word is in
+** the training set.
+*/
+void Dict::addtoken(WVit it) {
+  int t;
+
+  t = corpus.push(it->getord());
+  if ((t >= NVEC) && (it != &empty)) {
+    it->addprec(t);
+    if (intrain[it->getord()]) negs.add(t);
+  } // end if (t)
+} // end addtoken()
+
 /*
 ** The exist() function returns TRUE if there is an entry matching a string 
 ** search template in the dictionary, and FALSE otherwise.
 */
-bool Dict::exist(string sw) {
-  WVit     it;
-  wordvect temp(sw);
-
-  it = words.find(temp);
-  if (it == words.end()) return false;
-  else                   return true;
+bool Dict::exist(const string &sw) {
+  return (find(sw) != &empty);
 }
 
 /*
 ** The find() functions return an iterator that points to a wordvect in the 
 ** dictionary that matches a search template.  If there is not an entry that 
-** matches the search template, it returns an iterator set equal to words.end().
+** matches the search template, it returns a pointer to the "empty" entry (which
+** has an ordinal of -1).
 */
 // use a wordvect as a search template
 WVit Dict::find(wordvect &wfind) {
-  return(words.find(wfind));
+  return(find(wfind.str()));
 }
 // use a string as a search template
-WVit Dict::find(string sw) {
-  wordvect temp(sw);
-  return(find(temp));
+WVit Dict::find(const string &sw) {
+  int s;
+
+  s = probe(sw, hashstr(sw));
+  if (slots[s].o < 0) return &empty;
+  return byord[slots[s].o];
 }
 
+/*
+** The probe() function walks the probe sequence of a word in the hash table
+** (linear probing from the slot picked by its hash) and returns the slot that
+** holds the word, or the empty slot where it would be added if it is not there.
+*/
+int Dict::probe(const string &sw, uint32_t h) const {
+  int mask = slots.size() - 1;
+  int s    = h & mask;
+
+  while (slots[s].o >= 0) {
+    if ((slots[s].h == h) && (byord[slots[s].o]->str() == sw)) return s;
+    s = (s + 1) & mask;
+  } // end while (slots)
+  return s;
+} // end probe()
+
+/*
+** The rehash() function moves all of the entries of the hash table into a new
+** table with the number of slots given (a power of two).  The stored hashes
+** are reused, so no word has to be hashed again.
+*/
+void Dict::rehash(int n) {
+  vector<Hslot> old;
+  Hslot         none = { 0, -1 };
+  int           s;
+
+  old.swap(slots);
+  slots.assign(n, none);
+  for (int k=0; k<(int)old.size(); k++) {
+    if (old[k].o < 0) continue;
+    s = old[k].h & (n - 1);
+    while (slots[s].o >= 0) s = (s + 1) & (n - 1);
+    slots[s] = old[k];
+  } // end for (k)
+} // end rehash()
+
 /*
 ** The check() function checks to see if a wordvect iterator is valid.  It
 ** returns true if so, and false if not.
 */
 bool Dict::check(WVit tocheck) {
-  if (tocheck != words.end()) return true;
+  if ((tocheck != nullptr) && (tocheck != &empty)) return true;
   return false;
 } // end check()
 
 /*
 ** The write() function writes the dictionary index to a file in the "dict"
-** subdirectory.  This file can be later read in to reconstruct the multiset.
+** subdirectory.  This file can be later read in to reconstruct the dictionary.
 */
 void Dict::write(void) {
-  wordvect wv;
   WVit     it;
   ofstream ofile;
   outint   iout_sz, iout_ord, iout_len;
@@ -191,8 +333,8 @@ void Dict::write(void) {
   if (ofile.is_open()) {
     iout_sz.i = words.size();
     ofile.write(&iout_sz.c[0],4);
-    it = words.begin();
-    while (it != words.end()) {
+    for (int k=0; k<(int)words.size(); k++) {
+      it   = &words[k];
       word = it->str();
       iout_ord.i = it->getord();
       strcpy(charout,word.c_str());
@@ -202,8 +344,7 @@ void Dict::write(void) {
       ofile.write(&iout_ord.c[0],4);
       ofile.write(&iout_len.c[0],4);
       ofile.write(&charout[0],iout_len.i);
-      it++;
-    } // end while (it)
+    } // end for (k)
     ofile.close();
   } // end if (ofile)
   else {
@@ -218,8 +359,6 @@ void Dict::write(void) {
 ** instance.
 */
 void Dict::read(void) {
-  wordvect wv;
-  WVit     it;
   ifstream ifile;
   outint   iout_sz, iout_ord, iout_len;
   char     charout[50];
@@ -241,12 +380,11 @@ void Dict::read(void) {
       ifile.read(&charout[0],iout_len.i);
       charout[iout_len.i] = 0;
       if (iout_ord.i >= maxord) maxord = iout_ord.i + 1;
-       word = charout;
-      wv.clear();
-      wv = word;
+      word = charout;
+      wordvect wv(word);
       wv.setord(iout_ord.i);
       //cout << wv << endl;
-      addword(wv, false);
+      addword(std::move(wv), false);
     } // end for (i)
     ifile.close();
     nord = maxord;
@@ -256,6 +394,214 @@ void Dict::read(void) {
   } // end else (ofile)
 } // end write()
 
+/*
+** The save() function writes the models (weights and optimal threshold) of every
+** word that has them to a single packed file in the "dict" subdirectory, which
+** replaces the one data file per word that older versions wrote (see import()).
+** The file has the following layout (all integers are 32 bits except the offsets):
+**
+**   header : "WPAK", version, number of ordinals (nord), number of models
+**   table  : nord 64-bit offsets, indexed by ordinal (0 = the word has no model)
+**   blocks : for each model, the word length, the word, the threshold, the
+**            nominal size of the weights, the number of explicit weights (n),
+**            then n indices followed by n values
+**
+** The word is stored with each model so that a model is never applied to a
+** different word that happens to have the same ordinal.  The same models are
+** also written (as an inverted precursor index) to the read-only model file
+** "dict/model.map" that is used by map().
+*/
+bool Dict::save(void) {
+  ofstream        ofile;
+  string          path, tmp;
+  vector<int64_t> off;
+  outint          iout;
+  outdbl          dout;
+  wdata          *w;
+  int64_t         pos;
+  int             nmod = 0;
+
+  if (IS_PLATFORM(LINUX)) 
+    path = "dict/model.pak";
+  else if (IS_PLATFORM(WINDOWS))
+    path = "dict\\model.pak";
+
+  // finding the words that have models and working out where each block goes
+  byord.resize(nord, &empty);
+  off.assign(nord, 0);
+  pos = 16 + 8 * (int64_t)nord;
+  for (int o=0; o<nord; o++) {
+    if (byord[o] == &empty) continue;
+    w = byord[o]->word_data();
+    if (!w->is_populated()) continue;
+    off[o] = pos;
+    pos   += 4 + byord[o]->str().length() + 8 + 4 + 4 + 12 * (int64_t)w->weights.count_explicit();
+    nmod++;
+  } // end for (o)
+
+  // the file is written under a temporary name and then renamed over the old one, so
+  // that a save that does not finish never leaves a truncated file behind
+  tmp = path + ".tmp";
+  ofile.open(tmp, ios::out | ios::binary);
+  if (!ofile.is_open()) {
+    cerr << "Error opening \"" << tmp << "\" model file for output." << endl;
+    return false;
+  } // end if (ofile)
+
+  ofile.write(PAK_MAGIC, 4);
+  iout.i = PAK_VERSION; ofile.write(&iout.c[0],4);
+  iout.i = nord;        ofile.write(&iout.c[0],4);
+  iout.i = nmod;        ofile.write(&iout.c[0],4);
+  ofile.write((const char*)off.data(), 8 * (int64_t)nord);
+
+  for (int o=0; o<nord; o++) {
+    if (off[o] == 0) continue;
+    w = byord[o]->word_data();
+    iout.i = byord[o]->str().length();
+    ofile.write(&iout.c[0],4);
+    ofile.write(byord[o]->str().c_str(), iout.i);
+    dout.d = w->thr;                       ofile.write(&dout.c[0],8);
+    iout.i = w->weights.size();            ofile.write(&iout.c[0],4);
+    iout.i = w->weights.count_explicit();  ofile.write(&iout.c[0],4);
+    for (int k=0; k<w->weights.count_explicit(); k++) 
+      { iout.i = w->weights.index(k); ofile.write(&iout.c[0],4); }
+    for (int k=0; k<w->weights.count_explicit(); k++) 
+      { dout.d = w->weights.value(k); ofile.write(&dout.c[0],8); }
+  } // end for (o)
+
+  ofile.close();
+  if (!ofile) return false;
+  if (rename(tmp.c_str(), path.c_str()) != 0) {
+    remove(path.c_str());                 // (some platforms do not replace on rename)
+    if (rename(tmp.c_str(), path.c_str()) != 0) return false;
+  } // end if (rename)
+
+  // writing the read-only model file from the models that were just saved
+  if (IS_PLATFORM(LINUX)) 
+    path = "dict/model.map";
+  else if (IS_PLATFORM(WINDOWS))
+    path = "dict\\model.map";
+
+  vector<char> use(words.size(), 0);
+  for (int j=0; j<(int)words.size(); j++) use[j] = words[j].word_data()->is_populated();
+  invert(use);
+  unmap();              // (the index only includes the populated words now)
+  return Mmodel::write(path, poff, pword, pwt, pord, psz, words.size(), vochash());
+} // end save()
+
+/*
+** The load() function reads the packed model file written by save() with one
+** open and a single sequential read, and gives every word in the dictionary
+** that has a model in the file its weights and optimal threshold.  A model is
+** only used if the word stored with it matches the word at that ordinal.  Every
+** block is checked against the size of the file before anything is used, and a
+** file that fails any check is rejected as a whole.  The return value is the 
+** number of models loaded (-1 if there is no valid file).
+*/
+int Dict::load(void) {
+  ifstream        ifile;
+  string          path, word;
+  vector<char>    buf;
+  int64_t         size, off;
+  int32_t         ver, no, len, sz, n, idx;
+  double          thr, val;
+  const char     *p;
+  wdata          *w;
+  int             nload = 0;
+
+  if (IS_PLATFORM(LINUX)) 
+    path = "dict/model.pak";
+  else if (IS_PLATFORM(WINDOWS))
+    path = "dict\\model.pak";
+
+  ifile.open(path, ios::in | ios::binary);
+  if (!ifile.is_open()) return -1;
+  ifile.seekg(0, ios::end);
+  size = ifile.tellg();
+  ifile.seekg(0, ios::beg);
+  buf.resize(size);
+  ifile.read(buf.data(), size);
+  ifile.close();
+
+  if ((size < 16) || (memcmp(buf.data(), PAK_MAGIC, 4) != 0)) return -1;
+  memcpy(&ver, &buf[4], 4);
+  memcpy(&no,  &buf[8], 4);
+  if ((ver != PAK_VERSION) || (no < 0) || (size < 16 + 8 * (int64_t)no)) return -1;
+
+  // checking that every block (the word, the threshold, the sizes, and then n indices
+  // and n values) lies inside the file and that every index fits in the weights
+  for (int o=0; o<no; o++) {
+    memcpy(&off, &buf[16 + 8 * (int64_t)o], 8);
+    if (off == 0) continue;
+    if ((off < 16 + 8 * (int64_t)no) || (off > size - 4)) return -1;
+    memcpy(&len, &buf[off], 4);
+    if ((len < 0) || (off + 4 + (int64_t)len + 16 > size)) return -1;
+    p = &buf[off + 4 + len + 8];
+    memcpy(&sz, p, 4);
+    memcpy(&n,  p + 4, 4);
+    if ((sz < 0) || (n < 0) || (n > sz)) return -1;
+    if (off + 4 + (int64_t)len + 16 + 12 * (int64_t)n > size) return -1;
+    p += 8;
+    for (int k=0; k<n; k++) {
+      memcpy(&idx, p + 4*k, 4);
+      if ((idx < 0) || (idx >= sz)) return -1;
+    } // end for (k)
+  } // end for (o)
+
+  mm.close();           // (the weights in memory are used from now on)
+  byord.resize(nord, &empty);
+
+  for (int o=0; (o<no) && (o<nord); o++) {
+    memcpy(&off, &buf[16 + 8 * (int64_t)o], 8);
+    if ((off == 0) || (byord[o] == &empty)) continue;
+    p = &buf[off];
+    memcpy(&len, p, 4);  p += 4;
+    word.assign(p, len); p += len;
+    if (word != byord[o]->str()) continue;
+    memcpy(&thr, p, 8);  p += 8;
+    memcpy(&sz,  p, 4);  p += 4;
+    memcpy(&n,   p, 4);  p += 4;
+
+    w = byord[o]->word_data();
+    w->weights.resize(sz);
+    for (int k=0; k<n; k++) {
+      memcpy(&idx, p + 4*k, 4);
+      memcpy(&val, p + 4*(int64_t)n + 8*k, 8);
+      w->weights.sete(idx, val);
+    } // end for (k)
+    w->thr       = thr;
+    w->populated = true;
+    nload++;
+  } // end for (o)
+
+  indexed = false;
+  return nload;
+} // end load()
+
+/*
+** The import() function is a one-time conversion of the models saved by older versions,
+** which wrote one data file per word ("dict/<word>.dat").  Every word in the dictionary
+** that does not have a model yet is given the one in its data file (if there is one),
+** and all of the models are then saved to the packed model file, which is the only
+** place that they are read from afterwards.  The return value is the number of models
+** imported.
+*/
+int Dict::import(void) {
+  int nimp = 0;
+
+  if (mm.is_open()) load();  // (the mapped models have to be in memory to be saved again)
+  for (int k=0; k<(int)words.size(); k++) {
+    if (words[k].word_data()->is_populated()) continue;
+    if (words[k].read(false)) nimp++;
+  } // end for (k)
+  if (nimp > 0) {
+    prioritized = false;     // (the imported words are no longer prioritized)
+    indexed     = false;
+    save();
+  } // end if (nimp)
+  return nimp;
+} // end import()
+
 /*
 ** The loadnix() function loads words that are specifically excluded from
 ** modeling.  Roman numerals (such as those used for preamble pages and in
@@ -293,33 +639,26 @@ void Dict::loadnix(string fname1, string fname2) {
 
 /*
 ** The prioritize() function creates a priority list of iterators sorted by word frequency
-** that point directly to the corresponding word in the dictionary.
+** that point directly to the corresponding word in the dictionary.  Only the models in
+** memory are consulted (no file is opened), so the packed model file has to be loaded
+** first for the words that already have a model to be left out.
 */
 void Dict::prioritize() {
   WVit     wit;
-  string   fname, entry;
-  ifstream ifile;
   bool     nixed;
   cout << "prioritizing..." << endl;
   // erasing any previous priority list
   prilist.erase(prilist.begin(),prilist.end());
 
-  wit = words.begin();
-  while (wit != words.end()) {
-    entry = wit->str();
+  for (int k=0; k<(int)words.size(); k++) {
+    wit   = &words[k];
     // checking to see whether this word has been explicitly deprioritized
-    if (nix.find(entry) != nix.end()) nixed = true; else nixed = false;
-    if (!nixed) {
-      if (IS_PLATFORM(LINUX)) 
-        fname = "dict/" + entry + ".dat";
-      else if (IS_PLATFORM(WINDOWS))
-        fname = "dict\\" + entry + ".dat";
-      ifile.open(fname);
-      if (ifile.is_open()) ifile.close();
-      else                 prilist.push_front(wit);
-    } // end if (nixed)
-    wit++;
-  } // end while (wit)
+    if (nix.find(wit->str()) != nix.end()) nixed = true; else nixed = false;
+    // words that already have a model (from the packed model file or from a
+    // regression) are not prioritized either
+    if (wit->word_data()->is_populated()) nixed = true;
+    if (!nixed) prilist.push_front(wit);
+  } // end for (k)
   prilist.sort(byfreq);
 
   //cout << "Priority list:" << endl;
@@ -345,32 +684,75 @@ void Dict::prioritize() {
 ** 3, and "fox" would have a score of 4.  Higher scores indicate closer
 ** proximity to the next word.
 */
-struct prob_pair { int i; double d; };
-bool   pcomp(prob_pair &first, prob_pair &second) { return (first.d > second.d); }
+struct prob_pair { int i; int p; double d; };
+bool   pcomp(const prob_pair &first, const prob_pair &second) { 
+  if (first.d != second.d) return (first.d > second.d);
+  return (first.p > second.p);
+}
 
 int*   Dict::get_guesses(Svect &svin) {
-  list<prob_pair>            results;
-  list<prob_pair>::iterator  lit;
-  WVit                       wit;
+  vector<prob_pair>          results;
+  vector<int>                touched; // the model numbers of the words that can fire
   multiset<string>::iterator sit;
   prob_pair                  pp;
-  int                        i, m;
-  double                     thresh = 0.5;
+  Dvect                      prob;
+  const int                 *off, *wd, *ord, *sz;
+  const double              *wt;
+  int                        i, m, j, o, no, nm, np;
+  double                     thresh = 0.5, v;
 
   for (i=0; i<256; i++) guesses[i]=-1;
 
   // Figuring out what the probability of being the next word is for each
-  // word in the dictionary.  If the weights are not populated, and there
-  // is no data file saved, the probability will be zero.
-  //cout << "Before sorting:" << endl;
-  wit = words.begin();
-  while (wit != words.end()) {
-    pp.d = wit->find_prob(svin);
-    pp.i = wit->getord();
-    if (isnormal(pp.d)) if (pp.d > thresh) results.push_front(pp);
-    //cout << "i: " << pp.i << ", d: " << pp.d << "  " << svin << endl;
-    wit++;
-  }
+  // word in the dictionary.  A word's weighted sum only depends on its weights
+  // at the ordinals in the test vector, so the sums are accumulated from the
+  // postings of those ordinals only.  Every other word (including the words
+  // with no weights) has a weighted sum of zero and a probability of 0.5, 
+  // which is never above the threshold.  The logistic function is then 
+  // applied to all of the sums at once.  The postings come from the read-only
+  // model file if it is mapped, or else from the index built in memory.
+  if (mm.is_open()) {
+    off = mm.off(); wd = mm.word(); wt = mm.wt(); ord = mm.ord(); sz = mm.sz();
+    no  = mm.nord(); nm = mm.nmod(); np = mm.npost();
+  } // end if (mm)
+  else {
+    if (!indexed) build_index();
+    off = poff.data(); wd = pword.data(); wt = pwt.data(); ord = pord.data(); sz = psz.data();
+    no  = poff.size() - 1; nm = pord.size(); np = pword.size();
+  } // end else (mm)
+  // (the model file is only checked as it is read here, so any postings that point
+  // outside of the arrays are skipped instead of being followed)
+  for (int k=0; k<svin.count_explicit(); k++) {
+    o = svin.index(k);
+    v = svin.value(k);
+    if (o < 0) continue;  // (words that are not in the dictionary have no ordinal)
+    if (o >= no) break;
+    if ((off[o] < 0) || (off[o] > off[o+1]) || (off[o+1] > np)) continue;
+    for (int p=off[o]; p<off[o+1]; p++) {
+      j = wd[p];
+      if ((j < 0) || (j >= nm)) continue;
+      if (sz[j] != svin.size()) continue;
+      if (!imark[j]) { imark[j] = 1; touched.push_back(j); }
+      iacc[j] += v * wt[p];
+    } // end for (p)
+  } // end for (k)
+
+  prob.resize(touched.size());
+  for (int t=0; t<(int)touched.size(); t++) {
+    j = touched[t];
+    prob[t]  = iacc[j];
+    iacc[j]  = 0.0;
+    imark[j] = 0;
+  } // end for (t)
+  prob.sigmoid_elem();
+
+  for (int t=0; t<(int)touched.size(); t++) {
+    pp.d = prob[t];
+    pp.p = touched[t];
+    pp.i = ord[touched[t]];
+    if (pp.i < 0) continue;
+    if (isnormal(pp.d)) if (pp.d > thresh) results.push_back(pp);
+  } // end for (t)
 
   i = 0;
   // adding the standard guesses to the results
@@ -381,19 +763,138 @@ int*   Dict::get_guesses(Svect &svin) {
     sit++;
   }
 
-  // adding the regressed guesses to the results
-  results.sort(pcomp);
-  lit = results.begin();
-  while ((lit != results.end()) && (i < 256)) {
-    guesses[i] = lit->i;
-    //cout << "i: " << lit->i << ", d: " << lit->d << endl;
-    i++;
-    lit++;
-  }
+  // adding the regressed guesses to the results (ties are broken by model
+  // number, which follows the order of the vocabulary)
+  sort(results.begin(), results.end(), pcomp);
+  for (int t=0; (t<(int)results.size()) && (i<256); t++) guesses[i++] = results[t].i;
+
   nguesses = i;
   return guesses;
 }
 
+/*
+** The build_index() function builds the inverted precursor index: for every 
+** precursor ordinal, the list of (word, weight) pairs for the words that have an
+** explicit weight at that ordinal.  Only the models in memory are used (the ones
+** read from the packed model file by load() and the ones regressed since).
+*/
+void Dict::build_index(void) {
+  vector<char> loaded;
+
+  loaded.assign(words.size(), 0);
+  for (int j=0; j<(int)words.size(); j++) loaded[j] = words[j].word_data()->is_populated();
+
+  invert(loaded);
+  indexed = true;
+} // end build_index()
+
+/*
+** The invert() function fills in the index arrays from the models of the words
+** flagged in the argument (by position in the dictionary).  Each of 
+** those words is given a model number in vocabulary order, and the postings are
+** stored in one flat array ordered by ordinal, with an offset for each ordinal.
+*/
+void Dict::invert(const vector<char> &use) {
+  vector<int> mnum;
+  wdata      *w;
+  int         no = 0;
+
+  // numbering the models, then counting the postings for each ordinal and filling them in
+  mnum.assign(words.size(), -1);
+  pord.clear();
+  psz.clear();
+  for (int j=0; j<(int)words.size(); j++) {
+    if (!use[j]) continue;
+    w       = words[j].word_data();
+    mnum[j] = pord.size();
+    pord.push_back(words[j].getord());
+    psz.push_back(w->weights.size());
+    no      = max(no, w->weights.size());
+  } // end for (j)
+  poff.assign(no+1, 0);
+  for (int j=0; j<(int)words.size(); j++) {
+    if (!use[j]) continue;
+    w = words[j].word_data();
+    for (int k=0; k<w->weights.count_explicit(); k++) poff[w->weights.index(k)+1]++;
+  } // end for (j)
+  for (int o=0; o<no; o++) poff[o+1] += poff[o];
+
+  vector<int> cur(poff.begin(), poff.end() - 1);
+  pword.resize(poff[no]);
+  pwt.resize(poff[no]);
+  for (int j=0; j<(int)words.size(); j++) {
+    if (!use[j]) continue;
+    w = words[j].word_data();
+    for (int k=0; k<w->weights.count_explicit(); k++) {
+      pword[cur[w->weights.index(k)]]  = mnum[j];
+      pwt[cur[w->weights.index(k)]++]  = w->weights.value(k);
+    } // end for (k)
+  } // end for (j)
+
+  iacc.resize(pord.size());
+  imark.assign(pord.size(), 0);
+} // end invert()
+
+/*
+** The reindex() function marks the inverted precursor index as out of date, so
+** that it is rebuilt the next time it is needed.  It must be called whenever 
+** the weights of any word change (e.g. after a regression).
+*/
+void Dict::reindex(void) { indexed = false; mm.close(); }
+
+/*
+** The map() function maps the read-only model file written by save(), after
+** which the guesses are scored directly from the file instead of from the index
+** in memory (so no models need to be loaded at all).  The file has to match the
+** dictionary index that is loaded, since it refers to words by ordinal, so the
+** number of words and the hash of the dictionary stored in it are checked.  It 
+** returns false if there is no valid model file (or it is for another dictionary).
+*/
+bool Dict::map(void) {
+  string path;
+
+  if (IS_PLATFORM(LINUX)) 
+    path = "dict/model.map";
+  else if (IS_PLATFORM(WINDOWS))
+    path = "dict\\model.map";
+
+  if (!mm.open(path)) return false;
+  if ((mm.nvocab() != (int)words.size()) || (mm.vhash() != vochash())) {
+    mm.close();
+    return false;
+  } // end if (mm)
+  iacc.resize(mm.nmod());
+  imark.assign(mm.nmod(), 0);
+  return true;
+} // end map()
+
+/*
+** The vochash() function returns a hash (32-bit FNV-1a) of every word in the
+** dictionary together with its ordinal, which identifies the dictionary that a
+** read-only model file was made for.
+*/
+uint32_t Dict::vochash(void) const {
+  uint32_t h = 2166136261u;
+  int      o;
+
+  for (int k=0; k<(int)words.size(); k++) {
+    o = words[k].getord();
+    for (int b=0; b<4; b++) { h ^= (unsigned char)(o >> (8*b)); h *= 16777619u; }
+    for (size_t c=0; c<words[k].str().length(); c++) 
+      { h ^= (unsigned char)words[k].str()[c]; h *= 16777619u; }
+    h ^= 0xff; h *= 16777619u;    // (a byte that never appears in a word ends each one)
+  } // end for (k)
+  return h;
+} // end vochash()
+
+/*
+** The unmap() function stops using the read-only model file; the index is then
+** rebuilt from the models in memory the next time it is needed.
+*/
+void Dict::unmap(void) { mm.close(); indexed = false; }
+
+bool Dict::mapped(void) const { return mm.is_open(); }
+
 /*
 ** The num_guesses() function returns the number of valid guesses obtained 
 ** after running the get_guesses() function.
@@ -416,10 +917,11 @@ void Dict::show_guesses(void) {
 /*
 ** The getnew() function gets the string component of the next word in the 
 ** priority list that has not been regressed.  The word that is returned is 
-** popped off of the priority list.
+** popped off of the priority list.  It is safe to call from several threads.
 */
 string Dict::getnew() {
   string retstring;
+  lock_guard<mutex> lock(qlock);
   if (!prioritized) prioritize(); // if there is not a valid prioritization, create one
   retstring = prilist.front()->str();
   prilist.erase(prilist.begin());
@@ -433,38 +935,30 @@ string Dict::getnew() {
 */
 // use a wordvect as a search template
 const wordvect& Dict::get(wordvect &wfind) {
-  WVit it;
-  it = find(wfind);
-  if (it == words.end()) return empty;
-  else                   return *it;
+  return *find(wfind);
 }
 // use a string as a search template
-const wordvect& Dict::get(string sw) {
-  WVit it;
-  it = find(sw);
-  if (it == words.end()) return empty;
-  else                   return *it;
+const wordvect& Dict::get(const string &sw) {
+  return *find(sw);
 }
 
 /*
 ** The bracket ("[]") operator allows accessing an individual element in the 
 ** dict. This is equivalent to the "get" function (and, in fact, invokes it in 
 ** the first two cases).  The last case finds the wordvect that matches a 
-** specific ordinal; this one is slower, since it runs in O(n) time; the others 
-** run on O(log n) time.
+** specific ordinal, which is looked up in the ordinal table.  All of them run
+** in constant time.
 */
 // use another wordvect as a search template
 const wordvect& Dict::operator[](wordvect &wfind) {
   return (get(wfind));
 } // end "[]" (get) operator definition
 // use a string as a search template
-const wordvect& Dict::operator[](string sw) {
+const wordvect& Dict::operator[](const string &sw) {
   return (get(sw));
 } // end "[]" (get) operator definition
 // find a wordvect by looking for a specific ordinal
 const wordvect& Dict::operator[](int i) {
-  WVit it;
-  it = words.begin();
-  while (it != words.end()) { if ((*it).getord() == i) return *it; it++; }
-  return(empty);
+  if ((i < 0) || (i >= (int)byord.size())) return(empty);
+  return *byord[i];
 } // end "[]" (get) operator definition
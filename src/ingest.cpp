@@ -0,0 +1,155 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library implements the reading of training files (processfile() and readshards()).
+** See ingest.h.
+*/
+
+#include <unordered_map>
+#include <vector>
+
+#include "../include/ingest.h"
+#include "../include/workq.h"
+
+using namespace std;
+
+/*
+** The processfile() function reads in a file intended to be used for training.  If
+** the whole file is to be read (maxwords = 0) and there is more than one worker, the
+** file is read in parallel shards instead (see readshards()).  Otherwise the reading
+** stops at the end of the first whitespace-delimited piece of text after which more
+** than maxwords words have been read.  If the reading is to be resumed and the last 
+** call read the same file, the words after the point where it stopped are added to
+** the dictionary (up to the new maxwords) without starting over, which gives the same
+** dictionary as reading the file from the start.
+*/
+void processfile(string fname, Dict &d, Ingest &ing, int maxwords, int nw, bool resume) {
+  string     word;
+
+  if (!resume || (ing.fname != fname)) {
+    ing.tok.close();
+    ing.n     = 0;
+    ing.fname = fname;
+    if ((maxwords == 0) && (nw > 1)) { readshards(fname, d, nw); return; }
+    if (!ing.tok.open(fname)) {
+      ing.fname.clear();
+      cerr << "Bad input file name." << endl;
+      return;
+    } // end if (!open)
+    d.clear();
+  } // end if (!resume)
+
+  // (the reading only stops between whitespace-delimited pieces of text, so a piece that
+  // is split into several words is always read whole, as the old parser did)
+  while (((maxwords == 0) || (ing.n <= maxwords) || ing.tok.inpiece()) && ing.tok.next(word)) {
+    // the word is recorded in the corpus, which also gives it a precursor example
+    // once there are enough words before it
+    d.addtoken(d.addword(word));
+    ing.n++;
+  } // end while (tok)
+  if (!ing.tok.more()) ing.tok.close();
+
+  return;
+} // end processfile()
+
+/*
+** The Shard structure holds what one worker finds in its part of the file: the words
+** in the order that they first appear there (with their counts) and every token (as an
+** index into that list).
+*/
+struct Shard {
+  int64_t                     beg, len; // the part of the file (offset and length)
+  unordered_map<string,int>   ids;      // the index of each word in the list of words
+  vector<string>              vocab;    // the words in the order that they first appear
+  vector<int>                 cnt;      // the number of times that each word appears
+  vector<int>                 toks;     // every token (as an index into the list of words)
+  vector<WVit>                gword;    // the entry in the dictionary of each word
+};
+
+/*
+** The readshards() function does the same as processfile() for a whole file, using
+** several workers.  The file is cut into one shard per worker (each cut is moved up
+** to the next whitespace so that no word is split), and the work is done in three
+** steps (only the first one by the workers):
+**
+**   1. each worker tokenizes its shard, listing the words it finds (in order of first
+**      appearance, with counts) and its tokens
+**   2. the words are added to the dictionary shard by shard, in the order that they 
+**      first appear, so every word gets the same ordinal (and the same draw for the
+**      training and testing sets) that it gets when the file is read serially
+**   3. the tokens are recorded in the corpus shard by shard, so the corpus and the
+**      precursor examples end up the same as they do when the file is read serially
+*/
+void readshards(string fname, Dict &d, int nw) {
+  ifstream          ifile;
+  vector<Shard>     shards;
+  vector<int64_t>   cut;
+  Workq             pool(nw);
+  int64_t           size, off;
+  int               ns, c;
+
+  ifile.open(fname, ios::in | ios::binary);
+  if (!ifile.is_open()) {
+    cerr << "Bad input file name." << endl;
+    return;
+  } // end if (ifile)
+  ifile.seekg(0, ios::end);
+  size = ifile.tellg();
+
+  // cutting the file into shards at whitespace
+  ns = nw;
+  cut.assign(ns+1, size);
+  cut[0] = 0;
+  for (int k=1; k<ns; k++) {
+    off = max(size * k / ns, cut[k-1]);
+    ifile.clear();
+    ifile.seekg(off);
+    while (((c = ifile.get()) != EOF) && (c != ' ') && ((c < 9) || (c > 13))) off++;
+    cut[k] = min(off, size);
+  } // end for (k)
+  ifile.close();
+  shards.resize(ns);
+  for (int k=0; k<ns; k++) { shards[k].beg = cut[k]; shards[k].len = cut[k+1] - cut[k]; }
+
+  // 1. tokenizing the shards
+  pool.run([&](int wk) -> bool {
+    Tokenizer tok;
+    string    word;
+    unordered_map<string,int>::iterator it;
+
+    if (wk >= ns) return false;
+    Shard &sh = shards[wk];
+    tok.open(fname, sh.beg, sh.len);
+    while (tok.next(word)) {
+      it = sh.ids.find(word);
+      if (it == sh.ids.end()) {
+        it = sh.ids.insert(make_pair(word, (int)sh.vocab.size())).first;
+        sh.vocab.push_back(word);
+        sh.cnt.push_back(0);
+      } // end if (it)
+      sh.cnt[it->second]++;
+      sh.toks.push_back(it->second);
+    } // end while (tok)
+    return false;
+  }); // end pool.run()
+
+  // 2. adding the words to the dictionary
+  d.clear();
+  for (int k=0; k<ns; k++) {
+    Shard &sh = shards[k];
+    sh.gword.resize(sh.vocab.size());
+    for (int j=0; j<(int)sh.vocab.size(); j++) {
+      sh.gword[j] = d.addword(sh.vocab[j], sh.cnt[j]);
+    } // end for (j)
+    sh.ids.clear();
+    vector<string>().swap(sh.vocab);
+  } // end for (k)
+
+  // 3. recording the tokens in the corpus (which also makes the precursor examples)
+  for (int k=0; k<ns; k++) {
+    Shard &sh = shards[k];
+    for (int t=0; t<(int)sh.toks.size(); t++) d.addtoken(sh.gword[sh.toks[t]]);
+    vector<int>().swap(sh.toks);
+  } // end for (k)
+} // end readshards()
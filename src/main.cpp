@@ -5,28 +5,33 @@
 #include "../include/datamodule.h"
 #include "../include/dict.h"
 #include "../include/menu.h"
+#include "../include/workq.h"
+#include "../include/token.h"
+#include "../include/window.h"
+#include "../include/ingest.h"
 
 using namespace std;
 using namespace std::chrono;
 
-void   processfile(string, Dict&, int=1000);
 void   evalmodel(string, Dict&, int=0);
 double predictCalcTime(int,double=1.0,bool=false);
-string cleanword(string);
-int    parse(string, string[]);
 
 int main(int argv, char **argc) {
   Menu           mainMenu;
   Dict           words_used;
-  int            n, m, idx=0, N=1, maxwords = 5000, nobs, nobsmin;
+  int            n, m, idx=0, N=1, maxwords = 5000, nobs, nobsmin, ndone, nw;
   string         strtime, altfname, fname = "sherlock_holmes.txt", lastword="", nextword="", inword;
-  double         thr,f=1.0,ptime;
+  double         f=1.0;
   bool           incpool=true,fileread=false;
   Svect          testvector(MAXD);
-  string         words[10], teststring = "you are no longer";
+  string         word, teststring = "you are no longer";
+  Tokenizer      tok;
   int            *ret;
   ofstream       logfile;
   time_t         curtime;
+  Workq          pool;         // the worker threads used for regressions
+  Ingest         ing;          // where the reading of the training file stopped
+  mutex          outlock;      // serializes the work queue and output among the workers
 
   // creating default test vector
   //testvector[24]  = 1; // you
@@ -53,7 +58,7 @@ int main(int argv, char **argc) {
         cout << "Processing data source...";
         fflush(stdout);
         t1 = steady_clock::now();
-        processfile(fname, words_used, maxwords);
+        processfile(fname, words_used, ing, maxwords, pool.workers());
         t2 = steady_clock::now();
         cout << "Done." << endl;
         words_used.thresh(0);
@@ -62,6 +67,10 @@ int main(int argv, char **argc) {
         cout << "Writing dictionary index to disk...";
         fflush(stdout);
         words_used.write();
+        cout << "Done." << endl;
+        cout << "Loading regression models from disk...";
+        fflush(stdout);
+        words_used.load();
         cout << "Done." << endl << endl;
         nextword = words_used.getnew();
         fileread = true;
@@ -70,7 +79,19 @@ int main(int argv, char **argc) {
         cout << "Loading dictionary index from disk...";
         fflush(stdout);
         words_used.read();
+        ing.fname.clear(); // (the dictionary no longer matches the training file)
         cout << "Done." << endl;
+        // the read-only model file is enough to make guesses; the models themselves
+        // are only loaded if it is not there (or before any training, see below)
+        if (words_used.map()) {
+          cout << "Mapped read-only regression models." << endl;
+        } // end if (map)
+        else {
+          cout << "Loading regression models from disk...";
+          fflush(stdout);
+          words_used.load();
+          cout << "Done." << endl;
+        } // end else (map)
         break;
       case 3:
         if (fileread) {
@@ -83,51 +104,77 @@ int main(int argv, char **argc) {
       case 4:
         nobsmin = 300;
         words_used.thresh(0);
+        if (words_used.mapped()) words_used.load(); // (the mapped models are read-only)
         logfile.open("log.txt", std::ios_base::app);
-        for (int i = 0; i < N; i++) {  
+        ndone = 0;
+        while (ndone < N) {  
           if (fileread) nobs = words_used[nextword].num_obs(); else nobs=0;
           if (nobs > nobsmin) {
             incpool = true;
-            ptime = predictCalcTime(nobs,f);
-            cout << "Computing model for \"" << nextword << "\" (predicted time: "
-                 << setprecision(1) << fixed << ptime << " seconds)..." << endl;
-            fflush(stdout);
-            t1 = steady_clock::now();
-            words_used[nextword].solve(0.5, true);
-            thr = words_used[nextword].find_optimal();
-            t2 = steady_clock::now();
-            cout << endl << "Done." << endl << endl;
-            time_span = duration_cast<duration<double>>(t2 - t1);
-            cout << endl << "Elapsed time  : " << time_span.count() << " seconds.";
-            cout << endl << "Projected time: " << ptime << " seconds." << endl;
-            if (f == 1.0) f = time_span.count()/ptime;
-            else          f = (f*time_span.count()/ptime + f)/2.0;
-            cout <<"Optimal threshold for last regression: " << setprecision(4) << fixed << thr 
-                 << endl << endl;
-            cout << "Writing regression model for \"" << nextword << "\" to disk...";
+            // The workers pull words off of the priority list and regress them until
+            // the work queue is done, or until the next word does not have enough 
+            // observations (the data set is then adjusted below, with no workers running).
+            pool.run([&](int) -> bool {
+              string   word;
+              int      k;
+              double   wtime, wthr;
+              steady_clock::time_point w1, w2;
+              duration<double> wspan;
+
+              {
+                lock_guard<mutex> lock(outlock);
+                if (ndone >= N) return false;
+                if (fileread) nobs = words_used[nextword].num_obs(); else nobs=0;
+                if (nobs <= nobsmin) return false;
+                word     = nextword;
+                nextword = words_used.getnew();
+                k        = ndone++;
+                wtime    = predictCalcTime(nobs,f);
+                cout << "Computing model for \"" << word << "\" (predicted time: "
+                     << setprecision(1) << fixed << wtime << " seconds)..." << endl;
+                fflush(stdout);
+              }
+
+              w1 = steady_clock::now();
+              words_used[word].solve(0.5, (pool.workers() == 1));
+              wthr = words_used[word].find_optimal();
+              w2 = steady_clock::now();
+              wspan = duration_cast<duration<double>>(w2 - w1);
+
+              lock_guard<mutex> lock(outlock);
+              cout << endl << "Done (\"" << word << "\")." << endl << endl;
+              cout << endl << "Elapsed time  : " << wspan.count() << " seconds.";
+              cout << endl << "Projected time: " << wtime << " seconds." << endl;
+              if (f == 1.0) f = wspan.count()/wtime;
+              else          f = (f*wspan.count()/wtime + f)/2.0;
+              cout <<"Optimal threshold for last regression: " << setprecision(4) << fixed << wthr 
+                   << endl << endl;
+              lastword = word;
+              if (logfile.is_open()) {
+                time(&curtime);
+                strtime = ctime(&curtime);
+                strtime = strtime.substr(0,strtime.length()-1);
+                logfile << setprecision(1) << fixed;
+                logfile << "#" << setw(4) << k << " of " << setw(4) << N << " / " << strtime 
+                        << " : " << setw(15) << word << " : " << setw(5) 
+                        << wspan.count() << " sec " 
+                        << (words_used[word].isvalid()?"(success)":"(FAILURE)") << endl;
+              } // end if (logfile) 
+              return true;
+            }); // end pool.run()
+            cout << "Writing regression models to disk...";
             fflush(stdout);
-            words_used[nextword].write();
-            lastword = nextword;
-            nextword = words_used.getnew();
+            words_used.save();
             cout << "Done." << endl;
-            if (logfile.is_open()) {
-              time(&curtime);
-              strtime = ctime(&curtime);
-              strtime = strtime.substr(0,strtime.length()-1);
-              logfile << setprecision(1) << fixed;
-              logfile << "#" << setw(4) << i << " of " << setw(4) << N << " / " << strtime 
-                      << " : " << setw(15) << lastword << " : " << setw(5) 
-                      << time_span.count() << " sec " 
-                      << (words_used[lastword].isvalid()?"(success)":"(FAILURE)") << endl;
-              } // end if (logfile) 
           } // end if (nobs)
           else {
             if (incpool) {
               cout << "Increasing data set size to obtain more examples..." << endl;
               maxwords += 500;
-              processfile(fname, words_used, maxwords);
+              processfile(fname, words_used, ing, maxwords, pool.workers(), true);
               words_used.thresh(0);
               words_used.write();
+              words_used.load();
               nextword = words_used.getnew();
               fileread = true;
               incpool = false;
@@ -144,8 +191,10 @@ int main(int argv, char **argc) {
               } // end if (logfile)
             }
             cout << "Done." << endl;
+            ndone++;
           } // end else (nobs)
-        } // end for (i)
+        } // end while (ndone)
+        words_used.reindex();
         cout << "Done." << endl << endl;
         logfile.close();
         break;
@@ -166,6 +215,7 @@ int main(int argv, char **argc) {
         cout << "Please enter new value > ";
         cin  >> maxwords;
         fileread = false;
+        ing.fname.clear();
         break;
       case 8:
         cout << "Which word? > ";
@@ -177,11 +227,10 @@ int main(int argv, char **argc) {
         break;
       case 9:
         cout << "Test String: " << teststring << endl;
-        teststring = cleanword(teststring);
         testvector.resize(MAXD);
-        m = parse(teststring, words);
-        for (int i=0; i<m; i++) {
-          testvector[words_used[words[i]].getord()] = i + 1;
+        tok.assign(teststring);
+        for (m=0; tok.next(word); m++) {
+          testvector[words_used[word].getord()] = m + 1;
         }
         cout << "Test Vector: " << testvector << endl;
         ret = words_used.get_guesses(testvector);
@@ -206,11 +255,43 @@ int main(int argv, char **argc) {
         cout << "Testing model against \"" << altfname << "\":" << endl;
         evalmodel(altfname, words_used, 0);
         break;
+      case 13:
+        cout << "Current number of worker threads is " << pool.workers() << "." << endl;
+        cout << "Please enter a new number (0 = one per hardware thread) > ";
+        cin  >> nw;
+        pool.workers(nw);
+        break;
+      case 14:
+        cout << "Current number of negative examples for each positive example is " 
+             << words_used.negratio() << "." << endl;
+        cout << "Please enter a new number > ";
+        cin  >> n;
+        words_used.negratio(n);
+        break;
+      case 15:
+        // (models saved by older versions, one data file per word, are only ever read
+        // here; they are all written to the packed model file)
+        cout << "Importing regression models from the data files of older versions...";
+        fflush(stdout);
+        n = words_used.import();
+        cout << "Done (" << n << " imported)." << endl;
+        break;
+      case 16:
+        cout << "Current solver method is " << words_used.solver() << "." << endl;
+        cout << "  " << SOLVER_GRADIENT << " = gradient ascent, " << SOLVER_LBFGS << " = L-BFGS, "
+             << SOLVER_NEWTONCG << " = Newton-CG," << endl;
+        cout << "  " << SOLVER_SGD << " = SGD, " << SOLVER_ADAGRAD << " = Adagrad, "
+             << SOLVER_ADAM << " = Adam" << endl;
+        cout << "Please enter a new method > ";
+        cin  >> n;
+        words_used.solver(n);
+        break;
     }
 
     mainMenu.draw(0,50);
     mainMenu.addenda("Data Source: " + fname,false);
     mainMenu.addenda("Work queue : ",N,4,false);    
+    mainMenu.addenda("Workers    : ",pool.workers(),4,false);    
     mainMenu.addenda("Terminate  : ",maxwords,5,false);    
     mainMenu.addenda("Last word  : " + lastword,false);
     mainMenu.addenda("Next word  : " + nextword,false);
@@ -221,150 +302,60 @@ int main(int argv, char **argc) {
   return 0;
 } // end main()
 
-/*
-** The processfile() function reads in a file intended to be used for training.
-*/
-void processfile(string fname, Dict &d, int maxwords) {
-  ifstream   infile;
-  ofstream   logfile;
-  string     wordstring, dropword, group[NVEC+1];
-  int        n, m;
-  WVit       wit;
-  Svect      prec_example(MAXD);
-  string     words[10];
-  bool       dup;
-
-  infile.open(fname);
-  if (infile.is_open()) {
-    n = 0;
-    d.clear();
-    while (!infile.eof()) {
-      infile >> wordstring;
-      wordstring = cleanword(wordstring);
-      
-      m = parse(wordstring, words);
-      //cout << endl;
-      for (int j=0; j < m; j++) {
-        words[j] = cleanword(words[j]);
-        if (words[j] != "") {
-          d.addword(words[j]);
-          wit = d.find(words[j]);
-          if (n < NVEC) {
-            group[n] = words[j];
-            prec_example[wit->getord()] = n+1;
-          }
-          else {
-            group[NVEC] = words[j];
-            // checking for duplicates among the precursors - only want to drop if there are none
-            // in order to keep the highest value precursor
-            dup = false;
-            for (int i=1; i < NVEC; i++) if (group[0] == group[i]) dup = true;
-            if (!dup) dropword = group[0]; else dropword = "";
-            // shift every word to the left and add to the precursor data
-            for (int i = 0; i < NVEC; i++) {
-              //cout << group[i] << " ";
-              group[i] = group[i+1];
-            }
-            //testing code
-            //cout << "<" << words[j] << ">" << endl;
-            //cout << prec_example << endl;
-
-            wit->addprec(prec_example);
-            prec_example -= 1;                            // decrement the value of all precursor words by one
-            prec_example.remove(d[dropword].getord());    // remove the oldest word from the precursors
-            prec_example[d[words[j]].getord()] = NVEC;    // add the current word to the precursors
-
-          } // end else (n)
-          n++;
-        } // end if (words)
-      } // end for (j)
-      if ((maxwords != 0) && (n > maxwords)) break; // early termination 
-    } // end while (infile)
-    infile.close();
-  } // end if (infile)
-  else {
-    cerr << "Bad input file name." << endl;
-  } // end else (infile)
-
-  return;
-} // end processfile()
-
 /*
 ** The evalmodel() function reads in a file and evaluates the extent to which 
 ** the model can predict the next word.  The model is considered successful
 ** if the correct word is contained within the first 16 guesses.
 */
 void evalmodel(string fname, Dict &d, int wordno) {
-  ifstream   infile;
-  string     wordstring, dropword, group[NVEC+1];
-  int        n, m, ord, nguesses, ntrue=0, nfalse=0;
+  Tokenizer  tok(false);   // (the words only get one cleanword() pass, as they always did)
+  Window     win;
+  string     word;
+  int        n, ord, nguesses, ntrue=0, nfalse=0;
   WVit       wit;
   Svect      prec_example(MAXD);
-  string     words[10];
-  bool       dup, is_present;
+  bool       is_present;
   int       *ret;
 
-  infile.open(fname);
-  if (infile.is_open()) {
+  if (tok.open(fname)) {
     n = 0;
-    while (!infile.eof()) {
-      infile >> wordstring;
-      wordstring = cleanword(wordstring);
-      
-      m = parse(wordstring, words);
-      for (int j=0; j < m; j++) {
-        if (words[j] != "") {
-          wit = d.find(words[j]);
-          if (n < NVEC) {
-            group[n] = words[j];
-            prec_example[wit->getord()] = n+1;
-          }
-          else if (d.check(wit)) {
-            group[NVEC] = words[j];
-            // checking for duplicates among the precursors - only want to drop if there are none
-            // in order to keep the highest value precursor
-            dup = false;
-            for (int i=1; i < NVEC; i++) if (group[0] == group[i]) dup = true;
-            if (!dup) dropword = group[0]; else dropword = "";
-            // shift every word to the left and add to the precursor data
-            for (int i = 0; i < NVEC; i++) {
-              group[i] = group[i+1];
-            }
-
-            ord = d[words[j]].getord();
-            is_present = false;
-            if (n > wordno) {
-              ret = d.get_guesses(prec_example);
-              nguesses = d.num_guesses();
-              //nguesses = (nguesses>16?16:nguesses);
-              for (int k=0; k<nguesses; k++) {
-                if (ret[k] == ord) { is_present = true; break; }
-              } // end for (k)
-              if (is_present) ntrue++; else nfalse++;
-            } // end if (n)
-
-            cout << setprecision(1) << fixed;
-            cout << setw(5) << n << ": " << setw(15) << words[j] << " --> " << (is_present?"success":"FAILURE") 
-                 << " (" << (ntrue*100.0/(ntrue+nfalse))  << "%) " << prec_example << endl;
-
-            prec_example -= 1;                         // decrement the value of all precursor words by one
-            prec_example.remove(d[dropword].getord()); // remove the oldest word from the precursors
-            prec_example[ord] = NVEC;                  // add the current word to the precursors
-
-          } // end else (n)
-          n++;
-        } // end if (words)
-      } // end for (j)
-    } // end while (infile)
+    while (tok.next(word)) {
+      wit = d.find(word);
+      if (n < NVEC) {
+        win.push(wit->getord());
+      }
+      else if (d.check(wit)) {
+        win.features(prec_example);
+        ord = wit->getord();
+        is_present = false;
+        if (n > wordno) {
+          ret = d.get_guesses(prec_example);
+          nguesses = d.num_guesses();
+          //nguesses = (nguesses>16?16:nguesses);
+          for (int k=0; k<nguesses; k++) {
+            if (ret[k] == ord) { is_present = true; break; }
+          } // end for (k)
+          if (is_present) ntrue++; else nfalse++;
+        } // end if (n)
+
+        cout << setprecision(1) << fixed;
+        cout << setw(5) << n << ": " << setw(15) << word << " --> " << (is_present?"success":"FAILURE") 
+             << " (" << (ntrue*100.0/(ntrue+nfalse))  << "%) " << prec_example << endl;
+
+        win.push(ord);
+      } // end else (n)
+      n++;
+    } // end while (tok)
+    tok.close();
 
     cout << "Report ===============" << endl;
     cout << setprecision(1) << fixed;
     cout << "# of successes: " << setw(4) << ntrue  << " (" << (ntrue*100.0/(ntrue+nfalse))  << "%)" << endl;
     cout << "# of failures : " << setw(4) << nfalse << " (" << (nfalse*100.0/(ntrue+nfalse)) << "%)" << endl;
-  } // end if (infile)
+  } // end if (tok)
   else {
     cerr << "Bad input file name." << endl;
-  } // end else (infile)
+  } // end else (tok)
 
   return;
 } // end evalmodel()
@@ -373,89 +364,14 @@ void evalmodel(string fname, Dict &d, int wordno) {
 ** The predictCalcTime() function calculates a prediction of the amount of time required
 ** to converge on a calculation given the standard paramters on the reference machine.
 ** supplying a factor (f) to the function other than 1.0 will scale the calculation by
-** a constant factor.  This is done to account for variations in hardware.
+** a constant factor.  This is done to account for variations in hardware.  The 
+** optimizers converge in a few dozen iterations regardless of the problem size, so
+** the time is close to linear in the number of observations.
 */
 double predictCalcTime(int nobs, double f, bool init) {
   double ptime;
-  if (nobs <= 130) ptime = 0.4353*exp(0.0262*nobs);
-  else             ptime = 0.2636*nobs - 21.609;
+  ptime = 1.0E-04*nobs;
 
   if (init) return ptime;
   else      return (f*ptime);
 }
-
-/*
-** The cleanword() function converts all characters to lower case and strips out punctuation,
-** numbers, and other special characters, and replaces them with spaces.
-*/
-string cleanword(string inword) {
-  unsigned char c;
-  int    len, i;
-  string outword;
-
-  // skipping any leading spaces
-  i = 0;
-  while (inword[i] == ' ') { i++; }
-  if (i > 0) inword = inword.substr(i,inword.length());
-
-  len = inword.length();
-  for (i = 0; i < len; i++) {
-    c = inword[i];
-    // convert certain unicode values to mundane ascii equivalents
-    //if ((int)inword[i] == -30) if ((int)inword[i+1] == -128) if ((int)inword[i+2] == -103) { c = 39;  i+=2; }
-    //if ((int)inword[i] == -61) if ((int)inword[i+1] == -95)                                { c = 225; i+=1; }
-
-    //out << (int)c << " ";
-    if ((((int)c >= 97) && ((int)c <= 122)) || ((int)c >= 223) || 
-        (((int)c == 39) && (i != 0) && (i != (len-1)))) { outword += c; }
-    else {
-      // change upper case to lower case
-      if      (((int)c >= 65) && ((int)c <= 90))  { c += 32; outword += c; }
-      else if (((int)c >= 192) && ((int)c <=222)) { c += 32; outword += c; }
-      // use only one space in a consecutive string of spaces
-      else if (outword[outword.length()-1] != ' ')     outword += ' ';
-    } // end else (c)
-  } // end for (i)
-  //cout << endl;
-  return outword;
-} // end cleanword()
-
-/*
-** The parse() strips out spaces that are generated when special characters are replaced
-** by spaces in the cleanword() function and then splits up those components into different
-** words.
-*/
-int parse(string instr, string words[]) {
-  char   c;
-  string word;
-  bool   newword = false;
-  int    k;
-
-  for (int i=0; i<10; i++) words[i]="";
-  word = "";
-  k = 0;
-  for (int i=0; i<instr.length(); i++) {
-    c = instr[i];
-    if ((int)c == 32) {
-      newword = true;
-    } // end if (c, newword)
-    else if (newword == true) {
-      words[k] = word;
-      k++;
-      newword = false;
-      word = "";
-      word += c;
-    } // end else if (c, newword)
-    else {
-      word += c;
-    } // end else (c, newword)
-
-  } // end for (i)
-
-  words[k] = word;
-  newword = false;
-  word = "";
-  word += c;
-
-  return (k+1);
-} // end parse()
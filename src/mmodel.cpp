@@ -0,0 +1,167 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library implements the read-only mapped model file (Mmodel).  See mmodel.h.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+#include "../include/mmodel.h"
+#include "../include/wordvect.h"   // for the PLATFORM setting
+#include "../include/dict.h"       // for MAXD
+
+#if IS_PLATFORM(LINUX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/*
+** Constructor (no file is mapped).
+*/
+Mmodel::Mmodel() : base(nullptr), len(0), no(0), nm(0), np(0), nv(0), vh(0), poff(nullptr),
+                   pword(nullptr), pord(nullptr), psz(nullptr), pwt(nullptr) { }
+
+/*
+** Destructor (unmaps the file if there is one).
+*/
+Mmodel::~Mmodel() { close(); }
+
+/*
+** The open() function maps a model file read-only and sets up the array pointers
+** into it.  On Linux the file is mapped with mmap(), so nothing is actually read
+** until the pages are touched; elsewhere the whole file is read into memory.  Only
+** the header and the array sizes are checked (against the length of the file), so
+** opening costs the same no matter how large the file is; the postings themselves
+** are checked as they are used (see Dict::get_guesses()).  False is returned (with
+** nothing mapped) if the file is missing or invalid.
+*/
+bool Mmodel::open(string path) {
+  int32_t hdr[8];
+  size_t  need;
+
+  close();
+#if IS_PLATFORM(LINUX)
+  int         fd;
+  struct stat st;
+  void       *p;
+
+  fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  if ((fstat(fd, &st) != 0) || (st.st_size < 32)) { ::close(fd); return false; }
+  p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);                          // the mapping stays valid after the file is closed
+  if (p == MAP_FAILED) return false;
+  base = (char*)p;
+  len  = st.st_size;
+#else
+  ifstream ifile;
+
+  ifile.open(path, ios::in | ios::binary);
+  if (!ifile.is_open()) return false;
+  ifile.seekg(0, ios::end);
+  len = ifile.tellg();
+  ifile.seekg(0, ios::beg);
+  if (len < 32) { len = 0; return false; }
+  buf.resize(len);
+  ifile.read(buf.data(), len);
+  ifile.close();
+  base = buf.data();
+#endif
+
+  memcpy(hdr, base, 32);
+  need = 32 + 8 * (size_t)hdr[4] + 4 * ((size_t)hdr[2] + 1 + hdr[4] + 2 * (size_t)hdr[3]);
+  if ((memcmp(base, MAP_MAGIC, 4) != 0) || (hdr[1] != MAP_VERSION) || (hdr[2] < 0) ||
+      (hdr[2] > MAXD) || (hdr[3] < 0) || (hdr[4] < 0) || (len < need)) {
+    close();
+    return false;
+  } // end if (hdr)
+
+  no    = hdr[2];
+  nm    = hdr[3];
+  pwt   = (const double*)(base + 32);
+  poff  = (const int*)(pwt + hdr[4]);
+  pword = poff + no + 1;
+  pord  = pword + hdr[4];
+  psz   = pord + nm;
+  np    = hdr[4];
+  nv    = hdr[5];
+  vh    = (uint32_t)hdr[6];
+  return true;
+} // end open()
+
+/*
+** The close() function unmaps the model file (if there is one).
+*/
+void Mmodel::close(void) {
+#if IS_PLATFORM(LINUX)
+  if (base != nullptr) munmap(base, len);
+#else
+  buf.clear();
+  buf.shrink_to_fit();
+#endif
+  base = nullptr;
+  len  = 0;
+  no   = nm = np = nv = 0;
+  vh   = 0;
+  poff = pword = pord = psz = nullptr;
+  pwt  = nullptr;
+} // end close()
+
+bool Mmodel::is_open(void) const { return (base != nullptr); }
+int  Mmodel::nord(void) const    { return no; }
+int  Mmodel::nmod(void) const    { return nm; }
+int  Mmodel::npost(void) const   { return np; }
+int  Mmodel::nvocab(void) const  { return nv; }
+uint32_t Mmodel::vhash(void) const { return vh; }
+
+/*
+** The write() function writes the index arrays to a model file, along with the
+** number of words in the dictionary and a hash of them (the arrays refer to the
+** words by ordinal, so the file is only good for the same dictionary).  The file
+** is first written under a temporary name and then renamed over the old one, so a
+** process that has the old file mapped keeps seeing the old (complete) contents.
+*/
+bool Mmodel::write(string path, const vector<int> &off, const vector<int> &word,
+                   const vector<double> &wt, const vector<int> &ord, const vector<int> &sz,
+                   int nvoc, uint32_t vhash) {
+  ofstream ofile;
+  string   tmp = path + ".tmp";
+  int32_t  hdr[8];
+
+  ofile.open(tmp, ios::out | ios::binary);
+  if (!ofile.is_open()) {
+    cerr << "Error opening \"" << tmp << "\" model file for output." << endl;
+    return false;
+  } // end if (ofile)
+
+  memset(hdr, 0, 32);
+  memcpy(hdr, MAP_MAGIC, 4);
+  hdr[1] = MAP_VERSION;
+  hdr[2] = off.size() - 1;
+  hdr[3] = ord.size();
+  hdr[4] = wt.size();
+  hdr[5] = nvoc;
+  hdr[6] = (int32_t)vhash;
+  ofile.write((const char*)hdr, 32);
+  ofile.write((const char*)wt.data(),   8 * wt.size());
+  ofile.write((const char*)off.data(),  4 * off.size());
+  ofile.write((const char*)word.data(), 4 * word.size());
+  ofile.write((const char*)ord.data(),  4 * ord.size());
+  ofile.write((const char*)sz.data(),   4 * sz.size());
+  ofile.close();
+  if (!ofile) return false;
+
+  if (rename(tmp.c_str(), path.c_str()) != 0) {
+    remove(path.c_str());                 // (some platforms do not replace on rename)
+    if (rename(tmp.c_str(), path.c_str()) != 0) return false;
+  } // end if (rename)
+  return true;
+} // end write()
@@ -0,0 +1,536 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library provides the low-level numeric kernels used by the vector classes and the
+** logistic regression: dense element-by-element arithmetic, sums, a gather-based dot product
+** of a sparse vector against a dense array, and the exponential, logistic (sigmoid) and
+** log(1+exp(x)) functions applied to whole arrays, plus one byte kernel that maps text to
+** the character classes used by the tokenizer.  Each kernel has a plain scalar version
+** and, on x86-64 hosts built with gcc or clang, AVX2 and AVX-512 versions.  The instruction
+** set is chosen once at startup by asking the processor what it supports (CPUID), so the same
+** binary runs everywhere and uses the widest vectors available.
+*/
+
+#include <cmath>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+#include "../include/simd.h"
+
+using namespace std;
+
+/*
+** Constants used by the vectorized exponential and logarithm.  The exponential reduces its
+** argument to r = x - n*ln(2) with |r| <= ln(2)/2 (ln(2) is split into a high and a low part
+** so that the reduction is exact), evaluates a degree-11 Taylor polynomial in r and then
+** scales by 2^n.  The logarithm of (1+t) for 0 < t <= 1 uses log(y) = 2*atanh((y-1)/(y+1))
+** after halving y when it is larger than sqrt(2), so the series argument is always small.
+*/
+#define EXP_HI   709.0                     // largest argument before 2^n overflows
+#define EXP_LO  -708.0                     // smallest argument that still gives a normal number
+#define LOG2E    1.44269504088896340736
+#define LN2      0.693147180559945309417
+#define LN2HI    6.93147180369123816490e-01
+#define LN2LO    1.90821492927058770002e-10
+#define SQRT2M1  0.414213562373095048802
+
+static const double expc[12] = { 1.0, 1.0, 1.0/2, 1.0/6, 1.0/24, 1.0/120, 1.0/720, 1.0/5040,
+                                 1.0/40320, 1.0/362880, 1.0/3628800, 1.0/39916800 };
+static const double logc[11] = { 1.0, 1.0/3, 1.0/5, 1.0/7, 1.0/9, 1.0/11, 1.0/13, 1.0/15,
+                                 1.0/17, 1.0/19, 1.0/21 };
+
+/*
+******************************************************************************
+************************** SCALAR KERNELS HERE *******************************
+******************************************************************************
+*/
+
+static double sum_scalar(const double *a, int n) {
+  double sum = 0.0;
+  for (int i=0; i<n; i++) sum += a[i];
+  return sum;
+}
+
+static double dot_scalar(const double *a, const double *b, int n) {
+  double sum = 0.0;
+  for (int i=0; i<n; i++) sum += a[i] * b[i];
+  return sum;
+}
+
+static void axpy_scalar(double alpha, const double *x, double *y, int n) {
+  for (int i=0; i<n; i++) y[i] += alpha * x[i];
+}
+
+static void scale_scalar(double *a, double d, int n)      { for (int i=0; i<n; i++) a[i] *= d;    }
+static void mul_scalar(double *a, const double *b, int n) { for (int i=0; i<n; i++) a[i] *= b[i]; }
+static void add_scalar(double *a, const double *b, int n) { for (int i=0; i<n; i++) a[i] += b[i]; }
+static void sub_scalar(double *a, const double *b, int n) { for (int i=0; i<n; i++) a[i] -= b[i]; }
+
+static void threshold_scalar(double *a, double d, int n) {
+  for (int i=0; i<n; i++) a[i] = (a[i] >= d)?1.0:0.0;
+}
+
+static void exp_scalar(double *a, int n)     { for (int i=0; i<n; i++) a[i] = exp(a[i]); }
+static void sigmoid_scalar(double *a, int n) { for (int i=0; i<n; i++) a[i] = 1.0/(1.0 + exp(-a[i])); }
+
+// log(1+exp(x)) is computed as max(x,0) + log(1+exp(-|x|)) so that it never overflows
+static void log1pexp_scalar(double *a, int n) {
+  for (int i=0; i<n; i++) a[i] = (a[i] > 0.0?a[i]:0.0) + log1p(exp(-fabs(a[i])));
+}
+
+static double gather_dot_scalar(const int *idx, const double *v, int n, const double *d) {
+  double sum = 0.0;
+  for (int k=0; k<n; k++) sum += v[k] * d[idx[k]];
+  return sum;
+}
+
+/*
+** The character map gives, for every byte, the lower case letter it stands for (a-z and
+** everything from 223 up as is, A-Z and 192-222 shifted down by 32), an apostrophe for an
+** apostrophe, a space for whitespace, and zero for any other (separator) character.
+*/
+static unsigned char cmaptab[256];
+
+static bool cmapinit(void) {
+  for (int c=0; c<256; c++) {
+    if      (((c >= 97) && (c <= 122)) || (c >= 223) || (c == 39)) cmaptab[c] = c;
+    else if (((c >= 65) && (c <= 90)) || ((c >= 192) && (c <= 222))) cmaptab[c] = c + 32;
+    else if ((c == 32) || ((c >= 9) && (c <= 13)))                    cmaptab[c] = 32;
+    else                                                               cmaptab[c] = 0;
+  }
+  return true;
+}
+
+static const bool cmapready = cmapinit();
+
+static void cmap_scalar(const unsigned char *in, unsigned char *out, int n) {
+  for (int i=0; i<n; i++) out[i] = cmaptab[in[i]];
+}
+
+#ifdef SIMD_X86
+
+/*
+******************************************************************************
+*************************** AVX2 KERNELS HERE ********************************
+******************************************************************************
+*/
+
+#define AVX2 __attribute__((target("avx2,fma")))
+
+AVX2 static inline double hsum256(__m256d v) {
+  __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+AVX2 static inline __m256d exp256(__m256d x) {
+  __m256d n, r, p;
+  __m256i e;
+
+  x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(EXP_LO)), _mm256_set1_pd(EXP_HI));
+  n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(LOG2E)),
+                      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  r = _mm256_fnmadd_pd(n, _mm256_set1_pd(LN2HI), x);
+  r = _mm256_fnmadd_pd(n, _mm256_set1_pd(LN2LO), r);
+  p = _mm256_set1_pd(expc[11]);
+  for (int k=10; k>=0; k--) p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(expc[k]));
+  // building 2^n directly in the exponent bits
+  e = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+  e = _mm256_slli_epi64(_mm256_add_epi64(e, _mm256_set1_epi64x(1023)), 52);
+  return _mm256_mul_pd(p, _mm256_castsi256_pd(e));
+}
+
+// log(1+t) for 0 <= t <= 1
+AVX2 static inline __m256d log1p256(__m256d t) {
+  __m256d one = _mm256_set1_pd(1.0), half = _mm256_set1_pd(0.5);
+  __m256d big, y, num, den, s, z, p;
+
+  big = _mm256_cmp_pd(t, _mm256_set1_pd(SQRT2M1), _CMP_GT_OQ);
+  y   = _mm256_add_pd(one, t);
+  num = _mm256_blendv_pd(t, _mm256_fmsub_pd(y, half, one), big);
+  den = _mm256_blendv_pd(_mm256_add_pd(_mm256_set1_pd(2.0), t), _mm256_fmadd_pd(y, half, one), big);
+  s   = _mm256_div_pd(num, den);
+  z   = _mm256_mul_pd(s, s);
+  p   = _mm256_set1_pd(logc[10]);
+  for (int k=9; k>=0; k--) p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(logc[k]));
+  p   = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), s), p);
+  return _mm256_add_pd(p, _mm256_and_pd(big, _mm256_set1_pd(LN2)));
+}
+
+AVX2 static double sum_avx2(const double *a, int n) {
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  double  sum;
+  int     i = 0;
+  for (; i+8<=n; i+=8) {
+    s0 = _mm256_add_pd(s0, _mm256_loadu_pd(a+i));
+    s1 = _mm256_add_pd(s1, _mm256_loadu_pd(a+i+4));
+  }
+  if (i+4<=n) { s0 = _mm256_add_pd(s0, _mm256_loadu_pd(a+i)); i+=4; }
+  sum = hsum256(_mm256_add_pd(s0, s1));
+  for (; i<n; i++) sum += a[i];
+  return sum;
+}
+
+AVX2 static double dot_avx2(const double *a, const double *b, int n) {
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  double  sum;
+  int     i = 0;
+  for (; i+8<=n; i+=8) {
+    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a+i),   _mm256_loadu_pd(b+i),   s0);
+    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a+i+4), _mm256_loadu_pd(b+i+4), s1);
+  }
+  if (i+4<=n) { s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a+i), _mm256_loadu_pd(b+i), s0); i+=4; }
+  sum = hsum256(_mm256_add_pd(s0, s1));
+  for (; i<n; i++) sum += a[i] * b[i];
+  return sum;
+}
+
+AVX2 static void axpy_avx2(double alpha, const double *x, double *y, int n) {
+  __m256d av = _mm256_set1_pd(alpha);
+  int     i = 0;
+  for (; i+4<=n; i+=4) _mm256_storeu_pd(y+i, _mm256_fmadd_pd(av, _mm256_loadu_pd(x+i), _mm256_loadu_pd(y+i)));
+  for (; i<n; i++) y[i] += alpha * x[i];
+}
+
+AVX2 static void scale_avx2(double *a, double d, int n) {
+  __m256d dv = _mm256_set1_pd(d);
+  int     i = 0;
+  for (; i+4<=n; i+=4) _mm256_storeu_pd(a+i, _mm256_mul_pd(_mm256_loadu_pd(a+i), dv));
+  for (; i<n; i++) a[i] *= d;
+}
+
+AVX2 static void mul_avx2(double *a, const double *b, int n) {
+  int i = 0;
+  for (; i+4<=n; i+=4) _mm256_storeu_pd(a+i, _mm256_mul_pd(_mm256_loadu_pd(a+i), _mm256_loadu_pd(b+i)));
+  for (; i<n; i++) a[i] *= b[i];
+}
+
+AVX2 static void add_avx2(double *a, const double *b, int n) {
+  int i = 0;
+  for (; i+4<=n; i+=4) _mm256_storeu_pd(a+i, _mm256_add_pd(_mm256_loadu_pd(a+i), _mm256_loadu_pd(b+i)));
+  for (; i<n; i++) a[i] += b[i];
+}
+
+AVX2 static void sub_avx2(double *a, const double *b, int n) {
+  int i = 0;
+  for (; i+4<=n; i+=4) _mm256_storeu_pd(a+i, _mm256_sub_pd(_mm256_loadu_pd(a+i), _mm256_loadu_pd(b+i)));
+  for (; i<n; i++) a[i] -= b[i];
+}
+
+AVX2 static void threshold_avx2(double *a, double d, int n) {
+  __m256d dv = _mm256_set1_pd(d), one = _mm256_set1_pd(1.0);
+  int     i = 0;
+  for (; i+4<=n; i+=4)
+    _mm256_storeu_pd(a+i, _mm256_and_pd(_mm256_cmp_pd(_mm256_loadu_pd(a+i), dv, _CMP_GE_OQ), one));
+  for (; i<n; i++) a[i] = (a[i] >= d)?1.0:0.0;
+}
+
+AVX2 static void exp_avx2(double *a, int n) {
+  int i = 0;
+  for (; i+4<=n; i+=4) _mm256_storeu_pd(a+i, exp256(_mm256_loadu_pd(a+i)));
+  exp_scalar(a+i, n-i);
+}
+
+AVX2 static void sigmoid_avx2(double *a, int n) {
+  __m256d one = _mm256_set1_pd(1.0), neg = _mm256_set1_pd(-0.0);
+  int     i = 0;
+  for (; i+4<=n; i+=4) {
+    __m256d e = exp256(_mm256_xor_pd(_mm256_loadu_pd(a+i), neg));
+    _mm256_storeu_pd(a+i, _mm256_div_pd(one, _mm256_add_pd(one, e)));
+  }
+  sigmoid_scalar(a+i, n-i);
+}
+
+AVX2 static void log1pexp_avx2(double *a, int n) {
+  __m256d zero = _mm256_setzero_pd(), neg = _mm256_set1_pd(-0.0);
+  int     i = 0;
+  for (; i+4<=n; i+=4) {
+    __m256d x = _mm256_loadu_pd(a+i);
+    __m256d t = exp256(_mm256_or_pd(x, neg));                       // exp(-|x|)
+    _mm256_storeu_pd(a+i, _mm256_add_pd(_mm256_max_pd(x, zero), log1p256(t)));
+  }
+  log1pexp_scalar(a+i, n-i);
+}
+
+// the bytes of x that are in the range [lo,hi] (all ones where they are, zero elsewhere)
+AVX2 static inline __m256i inrange256(__m256i x, int lo, int hi) {
+  __m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8((char)lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8((char)(hi - lo))), d);
+}
+
+AVX2 static void cmap_avx2(const unsigned char *in, unsigned char *out, int n) {
+  const __m256i sp = _mm256_set1_epi8(32);
+  int i = 0;
+
+  for (; i+32<=n; i+=32) {
+    __m256i x    = _mm256_loadu_si256((const __m256i*)(in+i));
+    __m256i keep = _mm256_or_si256(_mm256_or_si256(inrange256(x, 97, 122), inrange256(x, 223, 255)),
+                                   _mm256_cmpeq_epi8(x, _mm256_set1_epi8(39)));
+    __m256i up   = _mm256_or_si256(inrange256(x, 65, 90), inrange256(x, 192, 222));
+    __m256i ws   = _mm256_or_si256(inrange256(x, 9, 13), _mm256_cmpeq_epi8(x, sp));
+    __m256i r    = _mm256_and_si256(x, keep);
+    r = _mm256_or_si256(r, _mm256_and_si256(_mm256_add_epi8(x, sp), up));
+    r = _mm256_or_si256(r, _mm256_and_si256(sp, ws));
+    _mm256_storeu_si256((__m256i*)(out+i), r);
+  }
+  cmap_scalar(in+i, out+i, n-i);
+}
+
+AVX2 static double gather_dot_avx2(const int *idx, const double *v, int n, const double *d) {
+  __m256d s = _mm256_setzero_pd();
+  int     k = 0, ti[4] = { 0, 0, 0, 0 };
+  double  tv[4] = { 0.0, 0.0, 0.0, 0.0 };
+  __m256i mask;
+
+  for (; k+4<=n; k+=4) {
+    __m256d g = _mm256_i32gather_pd(d, _mm_loadu_si128((const __m128i*)(idx+k)), 8);
+    s = _mm256_fmadd_pd(_mm256_loadu_pd(v+k), g, s);
+  }
+  if (k < n) {  // the remaining elements are gathered under a mask from padded copies
+    for (int j=0; j<n-k; j++) { ti[j] = idx[k+j]; tv[j] = v[k+j]; }
+    mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(n-k), _mm256_set_epi64x(3, 2, 1, 0));
+    __m256d g = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), d, _mm_loadu_si128((const __m128i*)ti),
+                                         _mm256_castsi256_pd(mask), 8);
+    s = _mm256_fmadd_pd(_mm256_loadu_pd(tv), g, s);
+  }
+  return hsum256(s);
+}
+
+/*
+******************************************************************************
+************************** AVX-512 KERNELS HERE ******************************
+******************************************************************************
+*/
+
+#define AVX512 __attribute__((target("avx512f")))
+
+AVX512 static inline __m512d exp512(__m512d x) {
+  __m512d n, r, p;
+
+  x = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(EXP_LO)), _mm512_set1_pd(EXP_HI));
+  n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(LOG2E)), _MM_FROUND_TO_NEAREST_INT);
+  r = _mm512_fnmadd_pd(n, _mm512_set1_pd(LN2HI), x);
+  r = _mm512_fnmadd_pd(n, _mm512_set1_pd(LN2LO), r);
+  p = _mm512_set1_pd(expc[11]);
+  for (int k=10; k>=0; k--) p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(expc[k]));
+  return _mm512_scalef_pd(p, n);
+}
+
+// log(1+t) for 0 <= t <= 1
+AVX512 static inline __m512d log1p512(__m512d t) {
+  __m512d  one = _mm512_set1_pd(1.0), half = _mm512_set1_pd(0.5);
+  __m512d  y, num, den, s, z, p;
+  __mmask8 big;
+
+  big = _mm512_cmp_pd_mask(t, _mm512_set1_pd(SQRT2M1), _CMP_GT_OQ);
+  y   = _mm512_add_pd(one, t);
+  num = _mm512_mask_blend_pd(big, t, _mm512_fmsub_pd(y, half, one));
+  den = _mm512_mask_blend_pd(big, _mm512_add_pd(_mm512_set1_pd(2.0), t), _mm512_fmadd_pd(y, half, one));
+  s   = _mm512_div_pd(num, den);
+  z   = _mm512_mul_pd(s, s);
+  p   = _mm512_set1_pd(logc[10]);
+  for (int k=9; k>=0; k--) p = _mm512_fmadd_pd(p, z, _mm512_set1_pd(logc[k]));
+  p   = _mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(2.0), s), p);
+  return _mm512_mask_add_pd(p, big, p, _mm512_set1_pd(LN2));
+}
+
+AVX512 static double sum_avx512(const double *a, int n) {
+  __m512d s = _mm512_setzero_pd();
+  int     i = 0;
+  for (; i+8<=n; i+=8) s = _mm512_add_pd(s, _mm512_loadu_pd(a+i));
+  if (i < n) { s = _mm512_add_pd(s, _mm512_maskz_loadu_pd((__mmask8)((1u << (n-i)) - 1), a+i)); }
+  return _mm512_reduce_add_pd(s);
+}
+
+AVX512 static double dot_avx512(const double *a, const double *b, int n) {
+  __m512d  s = _mm512_setzero_pd();
+  __mmask8 m;
+  int      i = 0;
+  for (; i+8<=n; i+=8) s = _mm512_fmadd_pd(_mm512_loadu_pd(a+i), _mm512_loadu_pd(b+i), s);
+  if (i < n) {
+    m = (__mmask8)((1u << (n-i)) - 1);
+    s = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, a+i), _mm512_maskz_loadu_pd(m, b+i), s);
+  }
+  return _mm512_reduce_add_pd(s);
+}
+
+AVX512 static void axpy_avx512(double alpha, const double *x, double *y, int n) {
+  __m512d av = _mm512_set1_pd(alpha);
+  int     i = 0;
+  for (; i+8<=n; i+=8) _mm512_storeu_pd(y+i, _mm512_fmadd_pd(av, _mm512_loadu_pd(x+i), _mm512_loadu_pd(y+i)));
+  for (; i<n; i++) y[i] += alpha * x[i];
+}
+
+AVX512 static void scale_avx512(double *a, double d, int n) {
+  __m512d dv = _mm512_set1_pd(d);
+  int     i = 0;
+  for (; i+8<=n; i+=8) _mm512_storeu_pd(a+i, _mm512_mul_pd(_mm512_loadu_pd(a+i), dv));
+  for (; i<n; i++) a[i] *= d;
+}
+
+AVX512 static void mul_avx512(double *a, const double *b, int n) {
+  int i = 0;
+  for (; i+8<=n; i+=8) _mm512_storeu_pd(a+i, _mm512_mul_pd(_mm512_loadu_pd(a+i), _mm512_loadu_pd(b+i)));
+  for (; i<n; i++) a[i] *= b[i];
+}
+
+AVX512 static void add_avx512(double *a, const double *b, int n) {
+  int i = 0;
+  for (; i+8<=n; i+=8) _mm512_storeu_pd(a+i, _mm512_add_pd(_mm512_loadu_pd(a+i), _mm512_loadu_pd(b+i)));
+  for (; i<n; i++) a[i] += b[i];
+}
+
+AVX512 static void sub_avx512(double *a, const double *b, int n) {
+  int i = 0;
+  for (; i+8<=n; i+=8) _mm512_storeu_pd(a+i, _mm512_sub_pd(_mm512_loadu_pd(a+i), _mm512_loadu_pd(b+i)));
+  for (; i<n; i++) a[i] -= b[i];
+}
+
+AVX512 static void threshold_avx512(double *a, double d, int n) {
+  __m512d dv = _mm512_set1_pd(d);
+  int     i = 0;
+  for (; i+8<=n; i+=8) {
+    __mmask8 m = _mm512_cmp_pd_mask(_mm512_loadu_pd(a+i), dv, _CMP_GE_OQ);
+    _mm512_storeu_pd(a+i, _mm512_maskz_mov_pd(m, _mm512_set1_pd(1.0)));
+  }
+  for (; i<n; i++) a[i] = (a[i] >= d)?1.0:0.0;
+}
+
+AVX512 static void exp_avx512(double *a, int n) {
+  int i = 0;
+  for (; i+8<=n; i+=8) _mm512_storeu_pd(a+i, exp512(_mm512_loadu_pd(a+i)));
+  exp_scalar(a+i, n-i);
+}
+
+AVX512 static void sigmoid_avx512(double *a, int n) {
+  __m512d one = _mm512_set1_pd(1.0);
+  int     i = 0;
+  for (; i+8<=n; i+=8) {
+    __m512d e = exp512(_mm512_sub_pd(_mm512_setzero_pd(), _mm512_loadu_pd(a+i)));
+    _mm512_storeu_pd(a+i, _mm512_div_pd(one, _mm512_add_pd(one, e)));
+  }
+  sigmoid_scalar(a+i, n-i);
+}
+
+AVX512 static void log1pexp_avx512(double *a, int n) {
+  __m512d zero = _mm512_setzero_pd();
+  int     i = 0;
+  for (; i+8<=n; i+=8) {
+    __m512d x = _mm512_loadu_pd(a+i);
+    __m512d t = exp512(_mm512_sub_pd(zero, _mm512_abs_pd(x)));     // exp(-|x|)
+    _mm512_storeu_pd(a+i, _mm512_add_pd(_mm512_max_pd(x, zero), log1p512(t)));
+  }
+  log1pexp_scalar(a+i, n-i);
+}
+
+AVX512 static double gather_dot_avx512(const int *idx, const double *v, int n, const double *d) {
+  __m512d  s = _mm512_setzero_pd();
+  __mmask8 m;
+  int      k = 0, ti[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+  for (; k+8<=n; k+=8) {
+    __m512d g = _mm512_i32gather_pd(_mm256_loadu_si256((const __m256i*)(idx+k)), d, 8);
+    s = _mm512_fmadd_pd(_mm512_loadu_pd(v+k), g, s);
+  }
+  if (k < n) {  // the remaining elements are gathered under a mask from a padded index copy
+    for (int j=0; j<n-k; j++) ti[j] = idx[k+j];
+    m = (__mmask8)((1u << (n-k)) - 1);
+    __m512d g = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), m,
+                                         _mm256_loadu_si256((const __m256i*)ti), d, 8);
+    s = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, v+k), g, s);
+  }
+  return _mm512_reduce_add_pd(s);
+}
+
+#endif // SIMD_X86
+
+/*
+******************************************************************************
+*************************** DISPATCH TABLE HERE ******************************
+******************************************************************************
+*/
+
+/*
+** The simd_table structure holds one implementation of every kernel.  There is one table
+** per instruction set, and the table in use is picked when the program starts.
+*/
+struct simd_table {
+  double (*sum)(const double*, int);
+  double (*dot)(const double*, const double*, int);
+  void   (*axpy)(double, const double*, double*, int);
+  void   (*scale)(double*, double, int);
+  void   (*mul)(double*, const double*, int);
+  void   (*add)(double*, const double*, int);
+  void   (*sub)(double*, const double*, int);
+  void   (*threshold)(double*, double, int);
+  void   (*exp)(double*, int);
+  void   (*sigmoid)(double*, int);
+  void   (*log1pexp)(double*, int);
+  double (*gather_dot)(const int*, const double*, int, const double*);
+  void   (*cmap)(const unsigned char*, unsigned char*, int);
+  const char *name;
+};
+
+static const simd_table tables[] = {
+  { sum_scalar, dot_scalar, axpy_scalar, scale_scalar, mul_scalar, add_scalar, sub_scalar, threshold_scalar,
+    exp_scalar, sigmoid_scalar, log1pexp_scalar, gather_dot_scalar, cmap_scalar, "scalar" },
+#ifdef SIMD_X86
+  { sum_avx2, dot_avx2, axpy_avx2, scale_avx2, mul_avx2, add_avx2, sub_avx2, threshold_avx2,
+    exp_avx2, sigmoid_avx2, log1pexp_avx2, gather_dot_avx2, cmap_avx2, "AVX2" },
+  { sum_avx512, dot_avx512, axpy_avx512, scale_avx512, mul_avx512, add_avx512, sub_avx512, threshold_avx512,
+    exp_avx512, sigmoid_avx512, log1pexp_avx512, gather_dot_avx512, cmap_avx2, "AVX-512" },
+#endif
+};
+
+/*
+** The detect() function asks the processor which vector extensions it supports and
+** returns the widest instruction set that can be used.
+*/
+static int detect(void) {
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))                                   return SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))    return SIMD_AVX2;
+#endif
+  return SIMD_SCALAR;
+}
+
+static const int         maxlevel = detect();          // the best instruction set available
+static const simd_table *kern     = &tables[maxlevel];  // the kernels currently in use
+
+/*
+** The simd_level() functions get and set the instruction set in use.  An instruction set
+** that is not supported by the processor cannot be selected; the return value is the
+** instruction set actually in use.
+*/
+int simd_level(void) { return (kern - tables); }
+
+int simd_level(int l) {
+  if ((l >= SIMD_SCALAR) && (l <= maxlevel)) kern = &tables[l];
+  return simd_level();
+}
+
+const char* simd_name(void) { return kern->name; }
+
+/*
+** The following functions pass through to the kernels for the selected instruction set.
+*/
+double simd_sum(const double *a, int n)                { return kern->sum(a, n);       }
+double simd_dot(const double *a, const double *b, int n) { return kern->dot(a, b, n);  }
+void   simd_axpy(double alpha, const double *x, double *y, int n) { kern->axpy(alpha, x, y, n); }
+void   simd_scale(double *a, double d, int n)          { kern->scale(a, d, n);         }
+void   simd_mul(double *a, const double *b, int n)     { kern->mul(a, b, n);           }
+void   simd_add(double *a, const double *b, int n)     { kern->add(a, b, n);           }
+void   simd_sub(double *a, const double *b, int n)     { kern->sub(a, b, n);           }
+void   simd_threshold(double *a, double d, int n)      { kern->threshold(a, d, n);     }
+void   simd_exp(double *a, int n)                      { kern->exp(a, n);              }
+void   simd_sigmoid(double *a, int n)                  { kern->sigmoid(a, n);          }
+void   simd_log1pexp(double *a, int n)                 { kern->log1pexp(a, n);         }
+
+double simd_gather_dot(const int *idx, const double *v, int n, const double *d)
+                                                       { return kern->gather_dot(idx, v, n, d); }
+void   simd_cmap(const char *in, char *out, int n)
+                               { kern->cmap((const unsigned char*)in, (unsigned char*)out, n); }
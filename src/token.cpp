@@ -0,0 +1,220 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library implements the streaming tokenizer (Tokenizer).  See token.h.
+*/
+
+#include <cstring>
+
+#include "../include/token.h"
+#include "../include/simd.h"
+
+using namespace std;
+
+/*
+** The squeeze() function finishes normalizing a piece of text that has been mapped to
+** character classes by simd_cmap(), in place: an apostrophe at either end becomes a
+** separator, and each run of separators (and whitespace) becomes a single space.  It
+** returns the new length.
+*/
+static int squeeze(char *m, int len) {
+  char c;
+  int  w = 0;
+
+  for (int i = 0; i < len; i++) {
+    c = m[i];
+    if ((c == 39) && ((i == 0) || (i == (len-1)))) c = 0;
+    if ((c != 0) && (c != ' '))            m[w++] = c;
+    // use only one space in a consecutive string of spaces
+    else if ((w == 0) || (m[w-1] != ' ')) m[w++] = ' ';
+  } // end for (i)
+  return w;
+} // end squeeze()
+
+/*
+** The cleanword() function converts all characters to lower case and strips out punctuation,
+** numbers, and other special characters, and replaces them with spaces (only one space for a
+** run of them).  An apostrophe is kept if it is not the first or last character, and leading
+** spaces are skipped.  The result is written to "out", which keeps its storage from one call
+** to the next.  The characters are classified through a lookup table (16 or 32 at a time if
+** the processor supports it, see simd_cmap()).
+*/
+void cleanword(const char *in, int len, string &out) {
+  while ((len > 0) && (*in == ' ')) { in++; len--; }
+  out.resize(len);
+  simd_cmap(in, &out[0], len);
+  out.resize(squeeze(&out[0], len));
+} // end cleanword()
+
+/*
+** The cleanmap() function does the same as cleanword() for a piece of text that has already
+** been mapped by simd_cmap() (the tokenizer maps its whole buffer at once).
+*/
+void cleanmap(const char *m, int len, string &out) {
+  out.assign(m, len);
+  out.resize(squeeze(&out[0], len));
+} // end cleanmap()
+
+/*
+** Constructor (there is nothing to read until open() or assign() is called).  If the
+** flag is false, the words are left as the first cleanword() pass makes them, i.e. an
+** apostrophe at either end of a word is kept (this is how the old parser read the text
+** that a model was tested against, see evalmodel()).
+*/
+Tokenizer::Tokenizer(bool e) : pos(0), lim(0), left(-1), eof(true), cp(0), edges(e) { }
+
+/*
+** Destructor (closes the file if there is one).
+*/
+Tokenizer::~Tokenizer() { close(); }
+
+/*
+** The open() function starts reading words from a file, or from the part of a file
+** that starts at the offset given and has the length given (-1 = the rest of the
+** file).  The part should start and end on whitespace so that no word is split.  It
+** returns false if the file cannot be opened.
+*/
+bool Tokenizer::open(const string &fname, int64_t beg, int64_t len) {
+  close();
+  ifile.open(fname, ios::in | ios::binary);
+  if (!ifile.is_open()) return false;
+  if (beg > 0) ifile.seekg(beg);
+  left = len;
+  buf.resize(TOKBUF);
+  cls.resize(TOKBUF);
+  eof = false;
+  return true;
+} // end open()
+
+/*
+** The assign() function starts reading words from a string instead of a file.
+*/
+void Tokenizer::assign(const string &text) {
+  close();
+  buf.assign(text.begin(), text.end());
+  cls.resize(buf.size());
+  lim = buf.size();
+  simd_cmap(buf.data(), cls.data(), lim);
+} // end assign()
+
+/*
+** The close() function stops reading and closes the file (if there is one).
+*/
+void Tokenizer::close(void) {
+  if (ifile.is_open()) ifile.close();
+  ifile.clear();
+  pos = lim = cp = 0;
+  left = -1;
+  eof = true;
+  clean.clear();
+} // end close()
+
+/*
+** The more() function returns true if there may be more words to read, i.e. the end of
+** the source has not been reached or there is still unread data in the buffer.
+*/
+bool Tokenizer::more(void) const {
+  return (!eof || (pos < lim) || (cp < clean.length()));
+} // end more()
+
+/*
+** The inpiece() function returns true if the whitespace-delimited piece of text that the
+** last word came from has more words left in it (the next word does not start a new one).
+*/
+bool Tokenizer::inpiece(void) const {
+  for (size_t k=cp; k<clean.length(); k++) if (clean[k] != ' ') return true;
+  return false;
+} // end inpiece()
+
+/*
+** The fill() function moves the data in the buffer from the position given onwards to
+** the front, and then reads as much of the file as will fit after it and maps what was
+** read to character classes.  The buffer only grows if a single piece of text fills it.
+** The end of the source is flagged when nothing more can be read.
+*/
+void Tokenizer::fill(size_t keep) {
+  size_t n, m;
+
+  if (eof) return;
+  if (keep > 0) {
+    memmove(buf.data(), buf.data() + keep, lim - keep);
+    memmove(cls.data(), cls.data() + keep, lim - keep);
+    lim -= keep;
+    pos -= keep;
+  } // end if (keep)
+  if (lim == buf.size()) { buf.resize(2 * buf.size()); cls.resize(buf.size()); }
+  m = buf.size() - lim;
+  if ((left >= 0) && ((int64_t)m > left)) m = left;
+  ifile.read(buf.data() + lim, m);
+  n    = ifile.gcount();
+  if (left >= 0) left -= n;
+  simd_cmap(buf.data() + lim, cls.data() + lim, n);
+  lim += n;
+  if (n == 0) eof = true;
+} // end fill()
+
+/*
+** The piece() function finds the next whitespace-delimited piece of text, and returns its
+** character classes (which are left in the buffer and stay valid until the next call).
+** It returns false at the end.
+*/
+bool Tokenizer::piece(const char *&p, int &len) {
+  size_t s;
+
+  // skipping whitespace (refilling the buffer as needed)
+  while (true) {
+    while ((pos < lim) && (cls[pos] == ' ')) pos++;
+    if ((pos < lim) || eof) break;
+    fill(pos);
+  } // end while (true)
+  if (pos == lim) return false;
+
+  // finding the end of the piece (the start of it is moved to the front of the buffer
+  // if the buffer has to be refilled)
+  s = pos;
+  while (true) {
+    while ((pos < lim) && (cls[pos] != ' ')) pos++;
+    if ((pos < lim) || eof) break;
+    fill(s);
+    s = 0;
+  } // end while (true)
+
+  p   = cls.data() + s;
+  len = pos - s;
+  return true;
+} // end piece()
+
+/*
+** The next() function gets the next word, returning false when there are no more.  The
+** word is copied into the argument, which keeps its storage from one call to the next.
+*/
+bool Tokenizer::next(string &word) {
+  const char *p;
+  int         len, n;
+  size_t      e;
+
+  // normalizing pieces of text until one has a word left in it
+  while (true) {
+    while ((cp < clean.length()) && (clean[cp] == ' ')) cp++;
+    if (cp < clean.length()) break;
+    if (!piece(p, len)) return false;
+    cleanmap(p, len, clean);
+    cp = 0;
+  } // end while (true)
+
+  e = clean.find(' ', cp);
+  if (e == string::npos) e = clean.length();
+  word.assign(clean, cp, e - cp);
+  cp = e;
+
+  // an apostrophe at either end of the word becomes a space (only one, if the word is "''")
+  if (!edges) return true;
+  n = word.length();
+  if (word[0] == '\'') word[0] = ' ';
+  if ((n > 1) && (word[n-1] == '\'')) {
+    if ((n == 2) && (word[0] == ' ')) word.resize(1);
+    else                              word[n-1] = ' ';
+  } // end if (n)
+  return true;
+} // end next()
@@ -2,19 +2,23 @@
 ** Created by: Jason Orender
 ** (c) 2018 all rights reserved
 **
-** This library implements a sparse vector format (Svect) using the multiset standard container.
-** This container was chosen so that new elements could be added or subtracted with minimal cost,
-** since this will happen quite often as elements become zeroes and need to be eliminated from
-** explicit expression in the vector.  Most operations, since this is meant to facilitate
-** operations on sparse vectors, will be accomplished by using the cache system O(1) retrieval
-** time.  For vectors that have too many nonzero values (>64), the data can be retrieved in
-** O(log n) time since the multiset standard container is used.  A standard list would have
-** required O(n) time in these cases.  Of course if the size of the vector is known, and it
-** is relatively small and constant, using the Dvect class will work best since it is only 
+** This library implements a sparse vector format (Svect) using a pair of parallel contiguous
+** arrays: one holding the indices of the explicit (nonzero) elements in ascending order, and one
+** holding the corresponding values.  Keeping the explicit elements sorted and packed together
+** means that element-by-element operations between two sparse vectors (products, sums, dot
+** products) reduce to a single linear merge over both index arrays, which is far friendlier to
+** the cache than walking a tree of individually allocated nodes.  Random access to a single
+** element is done with a binary search in O(log n) time.  Inserting a new element in the middle
+** of the vector costs O(n), but in practice elements are almost always appended in index order
+** or the explicit set is small.  Of course if the size of the vector is known, and it is
+** relatively small and constant, using the Dvect class will work best since it is only 
 ** allocated once and elements can be accessed in O(1) time.
 */
 
+#include <algorithm>
+
 #include "../include/vect.h"
+#include "../include/simd.h"
 
 using namespace std;
 
@@ -24,15 +28,81 @@ using namespace std;
 ******************************************************************************
 */
 
+/*
+** The dot() function returns the dot product of two sparse vectors.  This is the same
+** result as "(a * b).sum()", but it is done with a single merge-join over the two index
+** arrays and nothing is allocated.  When one vector has far fewer explicit elements than
+** the other (e.g. a handful of precursors against a full set of weights), the longer
+** array is skipped through with a binary search instead of being walked element-by-
+** element.  If the vectors are not of equal size, it returns zero.
+*/
+double dot(const Svect &a, const Svect &b) {
+  const Svect *s, *l;   // the vectors with the shorter and the longer index arrays
+  double sum = 0.0;
+  int    i, j, n, m, lo, hi, mid;
+
+  if (a.sz != b.sz) return 0.0;
+
+  if (a.idx.size() <= b.idx.size()) { s = &a; l = &b; } else { s = &b; l = &a; }
+  n = s->idx.size();
+  m = l->idx.size();
+
+  j = 0;
+  for (i=0; i<n; i++) {
+    if (8*n < m) {              // sparse against dense: binary search the rest of the longer array
+      lo = j; hi = m;
+      while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (l->idx[mid] < s->idx[i]) lo = mid + 1; else hi = mid;
+      } // end while (lo)
+      j = lo;
+    } // end if (n)
+    else {                      // comparable sizes: plain linear merge
+      while ((j < m) && (l->idx[j] < s->idx[i])) j++;
+    } // end else (n)
+    if (j == m) break;
+    if (l->idx[j] == s->idx[i]) sum += s->val[i] * l->val[j];
+  } // end for (i)
+
+  return sum;
+} // end dot()
+
+/*
+** The axpy() functions add a scaled sparse vector to another vector in place 
+** ("y += alpha*x"), so that nothing needs to be allocated for "alpha*x".  The first 
+** version accumulates into a sparse vector (see Svect::scale_add()); the second 
+** accumulates into a dense vector, which is an O(1) scatter per explicit element of 
+** "x" and never allocates.  If the vectors are not of equal size, they do nothing.
+*/
+void axpy(double alpha, const Svect &x, Svect &y) { y.scale_add(alpha, x); }
+
+void axpy(double alpha, const Svect &x, Dvect &y) {
+  if (x.sz != y.sz) return;
+  for (int k=0; k<(int)x.idx.size(); k++) y.a[x.idx[k]] += alpha * x.val[k];
+} // end axpy()
+
+/*
+** The dense versions of dot() and axpy() do the same operations on two dense vectors
+** using the vector kernels.  If the vectors are not of equal size, they return zero or
+** do nothing.
+*/
+double dot(const Dvect &a, const Dvect &b) {
+  if (a.sz != b.sz) return 0.0;
+  return simd_dot(a.a, b.a, a.sz);
+} // end dot()
+
+void axpy(double alpha, const Dvect &x, Dvect &y) {
+  if (x.sz != y.sz) return;
+  simd_axpy(alpha, x.a, y.a, y.sz);
+} // end axpy()
+
 /*
 ** Overloading the "<<" operator allows outputing the elements to an output stream.
 */
 
 ostream& operator<<(ostream& os, const Svect& v) {
-  multiset<Datapoint>::iterator it;
   os << "{ ";
-  it = v.a.begin();
-  while (it != v.a.end()) { os <<  "[" << it->i << "]" << *it->d << " "; it++; }
+  for (int k=0; k<(int)v.idx.size(); k++) os <<  "[" << v.idx[k] << "]" << v.val[k] << " ";
   //for (int i=0; i<v.size(); i++) os << v.element(i) << " ";
   os << "}";
   return os;
@@ -85,33 +155,149 @@ Svect::Svect(int n) { resize(n); }
 */
 Svect::Svect(const Svect &v) { copy(v); }
 
-Svect::~Svect(void) {
-  // explicitly erasing the list holding the data before destroying the object
-  a.erase(a.begin(),a.end());
- }
+/*
+** Move constructor.  The arrays are taken over from the other vector, which is left 
+** with no explicit elements (but the same nominal size).
+*/
+Svect::Svect(Svect &&v) noexcept
+  :idx(std::move(v.idx)), val(std::move(v.val)), sz(v.sz), tag_(v.tag_)
+{ 
+  v.idx.clear(); 
+  v.val.clear(); 
+}
+
+/*
+** Destructor (does nothing - the index and value arrays have their own destructors).
+*/
+Svect::~Svect(void) { }
+
+/*
+** The locate() function returns the position in the index array at which the element
+** with index "n" resides.  If there is no explicit element with that index, it returns
+** the position at which such an element would need to be inserted to keep the array
+** sorted.  The search can be started from a known position "from" (anything before it
+** is assumed to be smaller than "n").  Since elements are most often appended in 
+** ascending order, the end of the array is checked first.
+*/
+int Svect::locate(int n, int from) const {
+  int lo, hi, mid;
+
+  hi = idx.size();
+  if ((hi == from) || (idx[hi-1] < n)) return hi;   // belongs after the last element
+
+  lo = from;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (idx[mid] < n) lo = mid + 1; else hi = mid;
+  } // end while (lo)
+
+  return lo;
+} // end locate()
+
+/*
+** The scale_add() function adds a scaled copy of another vector to this one element-by-
+** element ("this += alpha*x") without creating a temporary for "alpha*x".  Both index
+** arrays are sorted, so this is done with a single merge; if "x" is much shorter than 
+** this vector, the merge jumps ahead with a binary search instead of stepping through
+** every element.  Elements in "x" that are not present in this vector are inserted; 
+** the arrays are grown once and merged from the back so that nothing needs to be 
+** shifted more than once, and nothing is allocated at all if every element of "x" is 
+** already present.  If the vectors are not of equal size, or "alpha" is zero, it does
+** nothing.
+*/
+Svect& Svect::scale_add(double alpha, const Svect &x) {
+  int  i, j, k, n, m, nnew;
+  bool jump;
+
+  if ((x.sz != sz) || (alpha == 0.0)) return *this;
+
+  n    = idx.size();
+  m    = x.idx.size();
+  jump = (8*m < n);
+
+  // counting the number of elements in "x" that are not already present in this vector
+  nnew = 0;
+  i = 0;
+  for (j=0; j<m; j++) {
+    if (jump) i = locate(x.idx[j], i);
+    else      while ((i < n) && (idx[i] < x.idx[j])) i++;
+    if ((i < n) && (idx[i] == x.idx[j])) i++; else nnew++;
+  } // end for (j)
+
+  if (nnew == 0) {        // every element is already present, so just add in place
+    i = 0;
+    for (j=0; j<m; j++) {
+      if (jump) i = locate(x.idx[j], i);
+      else      while (idx[i] < x.idx[j]) i++;
+      val[i] += alpha * x.val[j];
+    } // end for (j)
+    return *this;
+  } // end if (nnew)
+
+  // growing the arrays and merging from the back
+  idx.resize(n + nnew);
+  val.resize(n + nnew);
+  i = n - 1;
+  j = m - 1;
+  k = n + nnew - 1;
+  while (j >= 0) {
+    if ((i >= 0) && (idx[i] > x.idx[j])) 
+      { idx[k] = idx[i]; val[k] = val[i]; i--; }
+    else if ((i >= 0) && (idx[i] == x.idx[j])) 
+      { idx[k] = idx[i]; val[k] = val[i] + alpha * x.val[j]; i--; j--; }
+    else
+      { idx[k] = x.idx[j]; val[k] = alpha * x.val[j]; j--; }
+    k--;
+  } // end while (j)
+
+  return *this;
+} // end scale_add()
+
+/*
+** This version of scale_add() adds a scaled dense vector to this one, but only at the
+** positions that are already EXPLICIT in this vector ("this[i] += alpha*x[i]" for every
+** explicit i).  This is meant to apply a dense accumulator (e.g. a gradient) to a sparse
+** vector whose pattern is already known, so nothing is ever inserted or allocated.
+** If the vectors are not of equal size, it does nothing.
+*/
+Svect& Svect::scale_add(double alpha, const Dvect &x) {
+  if (x.sz != sz) return *this;
+  for (int k=0; k<(int)idx.size(); k++) val[k] += alpha * x.a[idx[k]];
+  return *this;
+} // end scale_add()
+
+/*
+** The scatter() function writes this vector into a dense vector of the same size (every
+** element that is not explicit becomes zero).  The gather() function does the reverse for
+** the EXPLICIT elements only, replacing their values with the ones in the dense vector.
+** Together they let a numeric kernel work on a dense copy of a vector whose pattern is
+** fixed.  If the vectors are not of equal size, they do nothing.
+*/
+void Svect::scatter(Dvect &x) const {
+  if (x.sz != sz) return;
+  x = 0.0;
+  for (int k=0; k<(int)idx.size(); k++) x.a[idx[k]] = val[k];
+} // end scatter()
+
+void Svect::gather(const Dvect &x) {
+  if (x.sz != sz) return;
+  for (int k=0; k<(int)idx.size(); k++) val[k] = x.a[idx[k]];
+} // end gather()
 
 /*
 ** The is_explicit() function returns whether the element is explicitly present in the
 ** list.  It will only be explicitly present if the value is nonzero.
 */
 bool Svect::is_explicit(int n) const {
-  multiset<Datapoint>::const_iterator it;
-  Datapoint dp;
-
-  dp.i = n;
-  it = a.find(dp);
-  return (it != a.end()); // return false if it is not present explicitly
+  int p = locate(n);
+  return ((p < (int)idx.size()) && (idx[p] == n)); // return false if it is not present explicitly
 }
 
 /*
 ** The find() function finds the first element that is equal to the argument.
 */
 int Svect::find(double d) const {
-  multiset<Datapoint>::const_iterator it;
-  Datapoint dp;
-
-  it = a.begin();
-  while (it != a.end()) { if ((*(it->d) - d) > EPSIL) return it->i; else it++; }
+  for (int k=0; k<(int)idx.size(); k++) if ((val[k] - d) > EPSIL) return idx[k];
 
   return (-1); // return -1 if there is no element matching
 }
@@ -121,11 +307,7 @@ int Svect::find(double d) const {
 ** is actually a valid number.
 */
 bool Svect::isvalid(void) const {
-  multiset<Datapoint>::const_iterator it;
-  Datapoint dp;
-
-  it = a.begin();
-  while (it != a.end()) { if (!isnormal(*(it->d))) return false; else it++; }
+  for (int k=0; k<(int)val.size(); k++) if (!isnormal(val[k])) return false;
 
   return true; // return true if there were no invalid elements
 
@@ -134,7 +316,15 @@ bool Svect::isvalid(void) const {
 ** The count_explicit() function returns the number of elements that are explicitly 
 ** present in the list.
 */
-int Svect::count_explicit(void) const { return a.size(); }
+int Svect::count_explicit(void) const { return idx.size(); }
+
+/*
+** The index() and value() functions return the index and the value of the k-th
+** explicit element (in ascending index order), where k runs from zero to 
+** count_explicit()-1.  There is no range checking.
+*/
+int    Svect::index(int k) const { return idx[k]; }
+double Svect::value(int k) const { return val[k]; }
 
 /*
 ** The remove() function removes an explicit element from the list, which essentially
@@ -142,78 +332,42 @@ int Svect::count_explicit(void) const { return a.size(); }
 ** be returned. If the element doesn't exist, it does nothing.
 */
 void Svect::remove(int n) {
-  int i=0;
-  multiset<Datapoint>::iterator it;
-  Datapoint dp;
-
-  if (cache_index[n%CSZ] == n) { 
-    a.erase(cache_it[n%CSZ]); 
-    cache_index[n%CSZ] = -1; 
-    return; 
-  } // end if (cache_index)
-  else {
-    dp.i = n;
-    it = a.find(dp);
-    if (it != a.end()) { a.erase(it); return; }
-  } // end else (cache_index)
+  int p = locate(n);
 
-} // end remove()
+  if ((p < (int)idx.size()) && (idx[p] == n)) {
+    idx.erase(idx.begin() + p);
+    val.erase(val.begin() + p);
+  } // end if (p)
 
-// this version takes an iterator as input
-multiset<Datapoint>::iterator Svect::remove(multiset<Datapoint>::iterator &it) {
-  if (cache_index[(*it).i%CSZ] == (*it).i) cache_index[(*it).i%CSZ] = -1;
-  return a.erase(it);
-}
+} // end remove()
 
 /*
 ** The element() function extracts an element of a specific ordinal from the list.  It
 ** is meant to simulate the behavior of an array from the user perspective.
 */
 double Svect::element(int n) const { 
-  multiset<Datapoint>::const_iterator it;
-  Datapoint dp;
+  int p = locate(n);
 
-  if (cache_index[n%CSZ] == n) return (*cache_dp[n%CSZ]);
-  else {
-    dp.i = n;
-    it = a.find(dp);
-    if (it != a.end()) return (*((*it).d)); 
-  } // end else (cache_index)
+  if ((p < (int)idx.size()) && (idx[p] == n)) return val[p];
 
   return 0.0; // always returns zero if a corresponding index was not found
 } // end element()
 
 /*
 ** The element_c() function is like the element() function, but it creates a list entry
-** if one was not found and passes back the reference.
+** if one was not found and passes back the reference.  Note that the reference is only
+** valid until the next element is added to or removed from the vector.
 */
 double& Svect::element_c(int n) { 
-  multiset<Datapoint>::iterator it;
-  Datapoint                 dp;
-
-  if (cache_index[n%CSZ] == n) return (*cache_dp[n%CSZ]); // returns cache value if in cache
-  else {
-    if (cache_index[n%CSZ] != -1) { // checks to see if this cache value has ever been used
-      dp.i = n;                     // if it has, then this index might already exist in the multiset
-      it = a.find(dp);
-      if (it != a.end()) {          // update the cache according to the data found in the multiset
-        cache_index[n%CSZ] = n;
-        cache_dp[n%CSZ]    = (*it).d;
-        cache_it[n%CSZ]    = it;
-        return (*cache_dp[n%CSZ]);
-      } // end if (it)
-    } // end if (cache_index)
-
-  // if the index is not in the cache or the multiset, add it to both
-  dp.i = n;
-  it = a.insert(dp);
-  cache_it[n%CSZ]    = it;
-  cache_index[n%CSZ] = n;
-  cache_dp[n%CSZ]    = (*it).d;
-
-  return (*cache_dp[n%CSZ]); // returns a new element if the index was not found
-
-  } // end else (cache_index)
+  int p = locate(n);
+
+  if ((p < (int)idx.size()) && (idx[p] == n)) return val[p]; // returns the existing element
+
+  // if the index is not present, insert it at the position that keeps the array sorted
+  idx.insert(idx.begin() + p, n);
+  val.insert(val.begin() + p, 0.0);
+
+  return val[p]; // returns a new element if the index was not found
 
 } // end element_c()
 
@@ -222,20 +376,13 @@ double& Svect::element_c(int n) {
 ** sparsity.
 */
 void Svect::setall(double d) {
-  multiset<Datapoint>::iterator it;
-  Datapoint dp;
   resize(sz);           // the easiest way is to simply start from scratch since none of the data
                         // will be retained
 
   if (d != 0) {         // this only needs to be done if the input value is nonzero
-    *dp.d = d;
-    for (int i=0; i<sz; i++) {
-      dp.i = i;
-      it = a.insert(dp); // need to create a new element for each entry (eliminates sparsity)
-      cache_it[i%CSZ]    = it;
-      cache_index[i%CSZ] = i;
-      cache_dp[i%CSZ]    = (*it).d;
-    }
+    idx.resize(sz);
+    val.assign(sz, d);  // need to create a new element for each entry (eliminates sparsity)
+    for (int i=0; i<sz; i++) idx[i] = i;
   }
 }
 
@@ -244,20 +391,7 @@ void Svect::setall(double d) {
 ** input value.
 */
 void Svect::set_explicit(double d) {
-  multiset<Datapoint>::iterator it;
-  double *dpoint;
-  int    i;
-
-  it = a.begin();
-  while (it != a.end()) {
-    dpoint = it->d;
-    i = it->i;
-    *dpoint = d;
-    cache_it[i%CSZ]    = it;
-    cache_index[i%CSZ] = i;
-    cache_dp[i%CSZ]    = (*it).d;
-    it++;
-  } // end while (it)
+  for (int k=0; k<(int)val.size(); k++) val[k] = d;
 } // end set_explicit();
 
 /*
@@ -266,20 +400,6 @@ void Svect::set_explicit(double d) {
 */
 void Svect::sete(int i,double d) { if (i < sz) element_c(i) = d; }
 
-/*
-** This version of set uses an iterator instead of an index.
-*/
-void Svect::sete(multiset<Datapoint>::iterator &it, double d) {
-  double *dp;
-  dp  = (*it).d;
-  *dp = d;
-  int i = (*it).i;
-  cache_index[i%CSZ] = i;
-  cache_dp[i%CSZ]    = (*it).d;
-  cache_it[i%CSZ]    = it;
-}
-
-
 /*
 ** The size() function returns the nominal size of the vector.
 */
@@ -288,26 +408,23 @@ int Svect::size(void) const { return sz; }
 /*
 ** The "*=" operator when used with two vectors multiplies each of the vectors
 ** together element-by-element.  This does not correspond to a true matrix multiplication.
-** If the vectors are not of equal size, it does nothing.
+** If the vectors are not of equal size, it does nothing.  Only elements that are explicit
+** in both vectors can survive, so this is a linear merge that compacts the arrays in place.
 */
 Svect& Svect::operator*=(const Svect &v) {
   double d;
-  int    i;
-  multiset<Datapoint>::iterator it;
+  int    j, k, w, m;
 
   if (v.size() == sz) {
-    if (sz < CSZ) { // all values should be cached if this is true
-      for (i=0; i<sz; i++) *cache_dp[i] *= v[i];
-    } // end if (sz)
-    else {
-      it = a.begin();
-      while (it != a.end()) {
-        i = (*it).i;
-        d = (*(*it).d) * v[i];
-        if (d != 0.0) { sete(it,d); it++; }
-        else            it = remove(it);
-      } // end while(it)
-    } // end else (sz)
+    m = v.idx.size();
+    j = w = 0;
+    for (k=0; k<(int)idx.size(); k++) {
+      while ((j < m) && (v.idx[j] < idx[k])) j++;
+      if ((j < m) && (v.idx[j] == idx[k])) d = val[k] * v.val[j]; else d = 0.0;
+      if (d != 0.0) { idx[w] = idx[k]; val[w] = d; w++; }
+    } // end for (k)
+    idx.resize(w);
+    val.resize(w);
   } // end if (v)
 
   return *this;
@@ -318,21 +435,8 @@ Svect& Svect::operator*=(const Svect &v) {
 ** vector by a constant.
 */
 Svect& Svect::operator*=(const double f) {
-  multiset<Datapoint>::iterator it;
-  double d;
-
   if (f != 0.0) {
-    if (sz < CSZ) { // all values should be cached if this is true
-      for (int i=0; i<sz; i++)  { if (cache_index[i] != -1) *cache_dp[i] *= f; }
-    } // end if (sz)
-    else {
-      it = a.begin();
-      while (it != a.end()) { 
-	d = (*(*it).d) * f;
-	sete(it, d); 
-	it++; 
-      }
-    } // end else (sz)
+    for (int k=0; k<(int)val.size(); k++) val[k] *= f;
   } // end if (f)
   else resize(sz); // this is the same as removing all explicit elements
 
@@ -364,24 +468,7 @@ Svect Svect::operator*(const Svect &v) {
 ** to this one. If the vectors are not of equal size, it does nothing.
 */
 Svect& Svect::operator+=(const Svect &v) {
-  int    i;
-  multiset<Datapoint>::const_iterator itc;
-
-  if (v.size() == sz) {	
-    if (sz < CSZ) { // all values should be cached if this is true
-      for (i=0; i<sz; i++) { if (v.cache_index[i] != -1) element_c(i) += *v.cache_dp[i]; }
-    } // end if (sz)
-    else {
-      itc = v.a.begin();
-      while (itc != v.a.end()) {
-	i = (*itc).i;
-	element_c(i) += *(*itc).d;
-	itc++;
-      } // end while (it)
-    } // end else (sz)
-  } // end if (v)
-
-  return *this;
+  return scale_add(1.0, v);
 } // end "+=" operator definition
 
 /*
@@ -399,24 +486,7 @@ Svect Svect::operator+(const Svect &v) {
 ** from this one. If the vectors are not of equal size, it does nothing.
 */
 Svect& Svect::operator-=(const Svect &v) {
-  int i;
-  multiset<Datapoint>::const_iterator itc;
-
-  if (v.size() == sz) { 
-    if (sz < CSZ) { // all values should be cached if this is true
-      for (i=0; i<sz; i++) { if (v.cache_index[i] != -1) element_c(i) -= *v.cache_dp[i]; }
-    } // end if (sz)
-    else {
-      itc = v.a.begin();
-      while (itc != v.a.end()) {
-        i = (*itc).i;
-        element_c(i) -= *(*itc).d;
-        itc++;
-      } // end while (it)
-    } // end else (sz)
-  } // end if (v)
-
-  return *this;
+  return scale_add(-1.0, v);
 } // end "-=" operator definition
 
 /*
@@ -424,21 +494,7 @@ Svect& Svect::operator-=(const Svect &v) {
 ** by the rhs argument.
 */
 Svect& Svect::operator-=(const double x) {
-  multiset<Datapoint>::iterator it;
-  double d;
-
-  if (sz < CSZ) { // all values should be cached if this is true
-    for (int i=0; i<sz; i++)  { if (cache_index[i] != -1) *cache_dp[i] -= x; }
-  } // end if (sz)
-  else {
-    it = a.begin();
-    while (it != a.end()) { 
-      d = (*(*it).d) - x;
-      sete(it, d); 
-      it++; 
-    } // end while (it)
-  } // end else (sz)
-
+  for (int k=0; k<(int)val.size(); k++) val[k] -= x;
   return *this;
 } // end "-=" operator definition
 
@@ -458,6 +514,23 @@ Svect Svect::operator-(const Svect &v) {
 */
 Svect& Svect::operator=(const Svect &v) { copy(v); return *this; }
 
+/*
+** This assignment operator takes over the arrays (and the tag) of a vector that is
+** about to go away instead of copying them.  The other vector is left with no
+** explicit elements.
+*/
+Svect& Svect::operator=(Svect &&v) noexcept {
+  if (this != &v) {
+    sz   = v.sz;
+    tag_ = v.tag_;
+    idx  = std::move(v.idx);
+    val  = std::move(v.val);
+    v.idx.clear();
+    v.val.clear();
+  } // end if (this)
+  return *this;
+}
+
 /*
 ** This assignment operator uses the setall() function to copy a double to every element
 ** in the vector.
@@ -478,15 +551,15 @@ double& Svect::operator[](int i) {
 
 
 /*
-** The resize() function resizes the vectors and destroys the data (sets to zero).
+** The resize() function resizes the vectors and destroys the data (sets to zero).  The
+** memory already reserved for the arrays is kept so that it can be reused.
 */
 bool Svect::resize(int n) {
-  // if ensure that the list is empty
-  a.erase(a.begin(),a.end());
+  // ensure that the arrays are empty
+  idx.clear();
+  val.clear();
   // set the new size
   sz = n;
-  // zero out the cache
-  memset(cache_index, -1, CSZ*sizeof(int));
 
   return true; // this basic case always returns true
 } // end resize()
@@ -507,22 +580,12 @@ bool Svect::upsize(int n) {
 ** in all cases (in this iteration of the code).
 */
 bool Svect::copy(const Svect &v) {
-  multiset<Datapoint>::const_iterator it, it2;
-  Datapoint dp;
-
   // resetting this vector size to the new vector size
-  resize(v.sz);
-
-  // copying the list data
-  it = v.a.begin();
-  while (it != v.a.end()) { 
-    dp.copy(*it);
-    it2 = a.insert(dp);
-    cache_it[dp.i%CSZ]    = it2;
-    cache_index[dp.i%CSZ] = dp.i;
-    cache_dp[dp.i%CSZ]    = (*it2).d;
-    it++; 
-  }
+  sz  = v.sz;
+
+  // copying the array data (reuses any memory this vector already has reserved)
+  idx = v.idx;
+  val = v.val;
 
   return true;  
 
@@ -532,35 +595,32 @@ bool Svect::copy(const Svect &v) {
 ** The sum() function returns a summation of all elements in a vector.
 */
 double Svect::sum(void) {
-  multiset<Datapoint>::iterator it;
   double sum=0.0;
 
-  if (sz < CSZ) { // all values should be cached if this is true
-    for (int i=0; i<sz; i++) { if (cache_index[i] != -1) sum+= *cache_dp[i]; }
-  } // end if (sz)
-  else {
-    it = a.begin();
-    while (it != a.end()) {
-      sum += *(*it).d;
-      it++;
-    } // end while (it)
-  } // end else (sz)
+  for (int k=0; k<(int)val.size(); k++) sum += val[k];
 
   return sum;
 } // end sum()
 
 /*
 ** The exp() function takes the exponential function of every element.  Note that
-** zeroes will potentially become explicit elements.
+** zeroes will potentially become explicit elements.  The arrays are rebuilt in a
+** single pass since nearly every element is likely to become explicit.
 */
 void Svect::exp_elem(void) {
+  vector<int>    nidx;
+  vector<double> nval;
   double d;
+  int    k = 0;
 
   for (int i=0; i<sz; i++) {
-    d = exp(element(i));
-    if (d > 0.00001) element_c(i) = d; else remove(i);
+    if ((k < (int)idx.size()) && (idx[k] == i)) d = exp(val[k++]); else d = exp(0.0);
+    if (d > 0.00001) { nidx.push_back(i); nval.push_back(d); }
   } // end for (i)
 
+  idx.swap(nidx);
+  val.swap(nval);
+
 } // exp_elem()
 
 /*
@@ -570,16 +630,15 @@ void Svect::exp_elem(void) {
 ** to one.
 */
 void Svect::apply_threshold(double f) {
-  multiset<Datapoint>::iterator it;
-  double d;
+  int w = 0;
 
   if ((f > 0.0) && (f <= 1.0)) {
 
-    it = a.begin();
-    while (it != a.end()) {
-      if (*(*it).d >= f) { sete(it, 1.0); it++; }
-      else                it = remove(it);
-    } // end while (it)
+    for (int k=0; k<(int)idx.size(); k++) {
+      if (val[k] >= f) { idx[w] = idx[k]; val[w] = 1.0; w++; }
+    } // end for (k)
+    idx.resize(w);
+    val.resize(w);
 
   } // end if (f)
 
@@ -591,17 +650,9 @@ void Svect::apply_threshold(double f) {
 ** the length will be len(A) + len(B).
 */
 void Svect::concat(Svect &B) {
-  multiset<Datapoint>::iterator it;
-  int  i, o = sz;
+  int  o = sz;
   sz += B.size();
-  it = B.a.begin();
-  while (it != B.a.end()) {
-    i = it->i + o;
-    element_c(i) = *it->d;
-    it++;
-    i++;
-  }
-
+  for (int k=0; k<(int)B.idx.size(); k++) element_c(B.idx[k] + o) = B.val[k];
 
 }
 
@@ -647,12 +698,23 @@ Dvect::Dvect(const Dvect &v) {
   if (resize(v.size())) copy(v);
 }
 
+/*
+** The move constructor takes over the array of a vector that is about to go away, 
+** which is left as an empty vector of zero size.
+*/
+Dvect::Dvect(Dvect &&v) noexcept {
+  a    = v.a;
+  sz   = v.sz;
+  v.a  = nullptr;
+  v.sz = 0;
+}
+
 /*
 ** The destructor deallocates any memory that was allocated.
 */
 Dvect::~Dvect(void) {
   // deallocating the memory set aside for the vector
-  if (a != nullptr) delete a;
+  if (a != nullptr) delete[] a;
 }
 
 /*
@@ -669,7 +731,7 @@ int    Dvect::size(void) const     { return sz; }
 ** equal size, it does nothing.
 */
 Dvect& Dvect::operator*=(const Dvect &v) {
-  if (v.size() == sz) { for (int i=0; i<sz; i++) a[i] *= v.a[i]; }
+  if (v.size() == sz) simd_mul(a, v.a, sz);
   return *this;
 }
 
@@ -678,7 +740,7 @@ Dvect& Dvect::operator*=(const Dvect &v) {
 ** vector by a constant.
 */
 Dvect& Dvect::operator*=(const double d) {
-  for (int i=0; i<sz; i++) a[i] *= d;
+  simd_scale(a, d, sz);
   return *this;
 }
 
@@ -707,7 +769,7 @@ Dvect Dvect::operator*(const Dvect &v) {
 ** If the vectors are not of equal size, it does nothing.
 */
 Dvect& Dvect::operator+=(const Dvect &v) {
-  if (v.size() == sz) { for (int i=0; i<sz; i++) a[i] += v.a[i]; }
+  if (v.size() == sz) simd_add(a, v.a, sz);
   return *this;
 }
 
@@ -726,7 +788,7 @@ Dvect Dvect::operator+(const Dvect &v) {
 ** If the vectors are not of equal size, it does nothing.
 */
 Dvect& Dvect::operator-=(const Dvect &v) {
-  if (v.size() == sz) { for (int i=0; i<sz; i++) a[i] -= v.a[i]; }
+  if (v.size() == sz) simd_sub(a, v.a, sz);
   return *this;
 }
 
@@ -750,6 +812,18 @@ Dvect& Dvect::operator=(const Dvect &v) {
   return *this;
 }
 
+/*
+** This assignment operator swaps arrays with a vector that is about to go away instead
+** of copying it, so that the old array of this vector is released by the other one.
+*/
+Dvect& Dvect::operator=(Dvect &&v) noexcept {
+  double *t;
+  int     n;
+  t = a;  a  = v.a;  v.a  = t;
+  n = sz; sz = v.sz; v.sz = n;
+  return *this;
+}
+
 /*
 ** This assignment operator uses the setall() function to copy a double to every element
 ** in the vector.
@@ -781,7 +855,7 @@ double& Dvect::operator[](int i) {
 */
 bool Dvect::resize(int n) {
   // if the array is already allocated, deallocate it
-  if (a != nullptr) delete a;
+  if (a != nullptr) delete[] a;
   // allocating a new vector ("a" for array)
   a = new double[n];
   // if the allocation was a success, the size is stored in "size"
@@ -806,16 +880,29 @@ bool Dvect::copy(const Dvect &v) {
 ** The sum() function returns a summation of all elements in a vector.
 */
 double Dvect::sum(void) {
-  double sum=0.0;
-  for (int i=0; i<sz; i++) sum+=a[i];
-  return sum;
+  return simd_sum(a, sz);
 }
 
 /*
 ** The exp() function takes the exponential function of every element.
 */
 void Dvect::exp_elem(void) {
-  for (int i=0; i<sz; i++) a[i] = exp(a[i]);
+  simd_exp(a, sz);
+}
+
+/*
+** The sigmoid_elem() function takes the logistic function 1/(1+exp(-x)) of every element.
+*/
+void Dvect::sigmoid_elem(void) {
+  simd_sigmoid(a, sz);
+}
+
+/*
+** The log1pexp_elem() function takes log(1+exp(x)) of every element without overflowing
+** for large arguments.
+*/
+void Dvect::log1pexp_elem(void) {
+  simd_log1pexp(a, sz);
 }
 
 /*
@@ -823,5 +910,160 @@ void Dvect::exp_elem(void) {
 ** the threshold to one and values less than the threshold to zero.
 */
 void Dvect::apply_threshold(double d) {
-  for (int i=0; i<sz; i++) a[i] = (a[i] >= d)?1.0:0.0;
+  simd_threshold(a, d, sz);
 }
+
+/*
+******************************************************************************
+******************** Smat CLASS DEFINITION BELOW HERE ************************
+******************************************************************************
+*/
+
+/*
+** The default constructor creates an empty matrix with no rows or columns.
+*/
+Smat::Smat(void) { clear(0); }
+
+/*
+** The alternate constructor creates an empty matrix with rows of nominal size n.
+*/
+Smat::Smat(int n) { clear(n); }
+
+/*
+** The clear() function discards all of the rows and sets the number of columns.  The
+** memory already reserved for the arrays is kept so that it can be reused.
+*/
+void Smat::clear(int n) {
+  off.clear();
+  col.clear();
+  val.clear();
+  off.push_back(0);
+  nc = n;
+} // end clear()
+
+/*
+** The add_row() function appends the explicit elements of a sparse vector to the end of
+** the matrix as a new row.
+*/
+void Smat::add_row(const Svect &v) {
+  col.insert(col.end(), v.idx.begin(), v.idx.end());
+  val.insert(val.end(), v.val.begin(), v.val.end());
+  off.push_back(col.size());
+} // end add_row()
+
+/*
+** This add_row() function appends a row given as "n" column indices (in ascending
+** order) and the matching values, so that a row can be added without building a
+** sparse vector for it first.
+*/
+void Smat::add_row(const int *c, const double *v, int n) {
+  col.insert(col.end(), c, c + n);
+  val.insert(val.end(), v, v + n);
+  off.push_back(col.size());
+} // end add_row()
+
+/*
+** The following functions are simple get functions.
+*/
+int Smat::rows(void) const { return off.size() - 1; }
+int Smat::cols(void) const { return nc;             }
+int Smat::nnz(void)  const { return col.size();     }
+
+/*
+** The row() function copies row "r" into a sparse vector of size cols().
+*/
+void Smat::row(int r, Svect &v) const {
+  v.resize(nc);
+  v.idx.assign(col.begin() + off[r], col.begin() + off[r+1]);
+  v.val.assign(val.begin() + off[r], val.begin() + off[r+1]);
+} // end row()
+
+/*
+** The pattern() function creates a sparse vector of size cols() that has an explicit
+** (zero) element for every column that is used in at least one row of the matrix.
+*/
+void Smat::pattern(Svect &v) const {
+  v.resize(nc);
+  v.idx = col;
+  sort(v.idx.begin(), v.idx.end());
+  v.idx.erase(unique(v.idx.begin(), v.idx.end()), v.idx.end());
+  v.val.assign(v.idx.size(), 0.0);
+} // end pattern()
+
+/*
+** The compact() function makes a copy of this matrix in which the columns that are used
+** in at least one row are renumbered 0..k-1 (keeping their order) and every unused column
+** is dropped, so the copy has k columns.  On return, cmap[j] holds the original column
+** number of column j in the copy.
+*/
+void Smat::compact(Smat &m, vector<int> &cmap) const {
+  cmap = col;
+  sort(cmap.begin(), cmap.end());
+  cmap.erase(unique(cmap.begin(), cmap.end()), cmap.end());
+
+  m.off = off;
+  m.val = val;
+  m.nc  = cmap.size();
+  m.col.resize(col.size());
+  for (int k=0; k<(int)col.size(); k++) 
+    m.col[k] = lower_bound(cmap.begin(), cmap.end(), col[k]) - cmap.begin();
+} // end compact()
+
+/*
+** The columns() function appends the column numbers used by row "r" to a list.
+*/
+void Smat::columns(int r, vector<int> &c) const {
+  c.insert(c.end(), col.begin() + off[r], col.begin() + off[r+1]);
+} // end columns()
+
+/*
+** The dot() function returns the dot product of row "r" with a sparse vector.  Rows are
+** expected to be short compared to the vector, so each element of the row is found in 
+** the vector with a binary search that starts where the last one left off.  If the
+** vector is not of size cols(), it returns zero.
+*/
+double Smat::dot(int r, const Svect &w) const {
+  double sum = 0.0;
+  int    p = 0, n = w.idx.size();
+
+  if (w.sz != nc) return 0.0;
+  for (int k=off[r]; k<off[r+1]; k++) {
+    p = w.locate(col[k], p);
+    if (p == n) break;
+    if (w.idx[p] == col[k]) sum += val[k] * w.val[p];
+  } // end for (k)
+
+  return sum;
+} // end dot()
+
+/*
+** This version of the dot() function returns the dot product of row "r" with a dense
+** vector, gathering the vector elements named by the row's column indices.  If the vector
+** is not of size cols(), it returns zero.
+*/
+double Smat::dot(int r, const Dvect &w) const {
+  if (w.sz != nc) return 0.0;
+  return simd_gather_dot(col.data() + off[r], val.data() + off[r], off[r+1] - off[r], w.a);
+} // end dot()
+
+/*
+** The axpy() function adds a scaled copy of row "r" to a dense vector in place 
+** ("y += alpha*x[r]").  If the vector is not of size cols(), it does nothing.
+*/
+void Smat::axpy(int r, double alpha, Dvect &y) const {
+  if (y.sz != nc) return;
+  for (int k=off[r]; k<off[r+1]; k++) y.a[col[k]] += alpha * val[k];
+} // end axpy()
+
+/*
+** Overloading the "<<" operator allows outputing the rows to an output stream (one
+** row per line, in the same format used for Svect).
+*/
+ostream& operator<<(ostream& os, const Smat& m) {
+  for (int r=0; r<m.rows(); r++) {
+    os << "{ ";
+    for (int k=m.off[r]; k<m.off[r+1]; k++) os << "[" << m.col[k] << "]" << m.val[k] << " ";
+    os << "}" << endl;
+  } // end for (r)
+  return os;
+} // end operator<< definition for Smat
@@ -2,6 +2,168 @@
 #include "../include/wdata.h"
 #include "../include/dict.h"
 
+/*
+** The precursors() function makes a precursor example (NVEC records) from the ordinals
+** of the "n" words in a window (oldest first): (ordinal, position), with position 1 =
+** oldest.  The window is walked from the newest word back, so a repeated word keeps its
+** newest position, and the records are sorted by ordinal.  Words that are not in the
+** dictionary (ordinal -1) are skipped, and the records left over get an ordinal of -1.
+*/
+void precursors(const int *win, int n, Prec *rec) {
+  int  ne = 0, o, k;
+  bool seen;
+
+  for (int p=n-1; p>=0; p--) {
+    o = win[p];
+    if (o < 0) continue;
+    seen = false;
+    for (k=0; k<ne; k++) if (rec[k].ord == o) { seen = true; break; }
+    if (seen) continue;
+    // insertion into the (sorted) list of records
+    for (k=ne; (k > 0) && (rec[k-1].ord > o); k--) rec[k] = rec[k-1];
+    rec[k].ord = o;
+    rec[k].pos = p + 1;
+    ne++;
+  } // end for (p)
+  for (k=ne; k<NVEC; k++) { rec[k].ord = -1; rec[k].pos = 0; }
+} // end precursors()
+
+/*
+******************************************************************************
+****************** Corpus CLASS DEFINITION BELOW HERE ************************
+******************************************************************************
+*/
+
+/*
+** Default constructor (the corpus starts out with no words).
+*/
+Corpus::Corpus(void) { }
+
+/*
+** The clear() function discards all of the words and the memory used for them.
+*/
+void Corpus::clear(void) { vector<int>().swap(ords); }
+
+/*
+** The push() function adds the ordinal of the next word and returns its position.
+*/
+int Corpus::push(int o) { ords.push_back(o); return ords.size() - 1; }
+
+int Corpus::size(void) const { return ords.size(); }
+
+/*
+** The "[]" operator returns the ordinal of the word at position "t".
+*/
+int Corpus::operator[](int t) const { return ords[t]; }
+
+/*
+** The features() function sets NVEC records to the precursor example of the word at
+** position "t", which is made from the (up to) NVEC words before it.
+*/
+void Corpus::features(int t, Prec *rec) const {
+  int b = (t > NVEC) ? (t - NVEC) : 0;
+  precursors(&ords[b], t - b, rec);
+} // end features()
+
+/*
+******************************************************************************
+****************** Pstore CLASS DEFINITION BELOW HERE ************************
+******************************************************************************
+*/
+
+/*
+** Default constructor (the store starts out with no examples).
+*/
+Pstore::Pstore(void) { }
+
+/*
+** The clear() function discards all of the examples and the memory used for them.
+*/
+void Pstore::clear(void) { vector<int>().swap(at); }
+
+/*
+** The add() function adds an example (by its position in the corpus) as the newest one.
+*/
+void Pstore::add(int t) { at.push_back(t); }
+
+/*
+** The following functions are simple get functions.
+*/
+int  Pstore::size(void)  const { return at.size();   }
+bool Pstore::empty(void) const { return at.empty();  }
+
+/*
+** The "[]" operator returns the position in the corpus of example "k", counting from
+** the newest example (0) back to the oldest.
+*/
+int Pstore::operator[](int k) const { return at[at.size() - 1 - k]; }
+
+/*
+******************************************************************************
+***************** Sampler CLASS DEFINITION BELOW HERE ************************
+******************************************************************************
+*/
+
+/*
+** Default constructor (no examples, and the default ratio of negative examples).
+*/
+Sampler::Sampler(void) : r(NEGRATIO) { }
+
+/*
+** The clear() function discards all of the examples and the memory used for them.
+** The ratio of negative examples is kept.
+*/
+void Sampler::clear(void) { vector<int>().swap(pool); }
+
+/*
+** The add() function adds an example (by its position in the corpus) to the examples
+** that negative examples are drawn from.
+*/
+void Sampler::add(int t) { pool.push_back(t); }
+
+int Sampler::size(void) const { return pool.size(); }
+
+/*
+** The ratio() functions set and get the number of negative examples drawn for each
+** positive example (at least one).
+*/
+void Sampler::ratio(int n) { r = (n < 1) ? 1 : n; }
+int  Sampler::ratio(void) const { return r; }
+
+/*
+** The draw() function draws "n" examples uniformly (with replacement) from all of the
+** examples in the sampler, leaving out the examples of the word with ordinal "skip",
+** and puts them into "out" (which is cleared first), using the generator "gen".  Each
+** draw takes constant time; an example of the word left out is simply drawn again,
+** and the drawing gives up after 4n tries in case (nearly) all of the examples are of
+** that word.
+*/
+void Sampler::draw(int n, int skip, const Corpus &cp, Pstore &out, mt19937 &gen) const {
+  int t, tries;
+
+  out.clear();
+  if (pool.empty()) return;
+  uniform_int_distribution<int> pick(0, pool.size() - 1);
+  for (tries=0; (out.size() < n) && (tries < 4*n); tries++) {
+    t = pool[pick(gen)];
+    if (cp[t] != skip) out.add(t);
+  } // end for (tries)
+} // end draw()
+
+/*
+** The addrow() function appends the precursor example of the word at position "t" of
+** the corpus to a features matrix as a row: column = ordinal, value = position.
+*/
+static void addrow(const Corpus &cp, int t, Smat &feat) {
+  Prec   p[NVEC];
+  int    c[NVEC], n = 0;
+  double v[NVEC];
+
+  cp.features(t, p);
+  for (int k=0; (k < NVEC) && (p[k].ord >= 0); k++) { c[n] = p[k].ord; v[n] = p[k].pos; n++; }
+  feat.add_row(c, v, n);
+} // end addrow()
+
 /*
 ******************************************************************************
 ******************* wdata STRUCT DEFINITION BELOW HERE ***********************
@@ -14,11 +176,33 @@
 */
 wdata::wdata(void)  { clear(); }
 
+/*
+** The move constructor takes over the precursor data and weights of an instance
+** that is about to go away instead of copying them.
+*/
+wdata::wdata(wdata &&wd) { *this = std::move(wd); }
+
 /*
 ** Destructor.
 */
 wdata::~wdata(void) { }
 
+/*
+** The move assignment operator takes over all of the data of another instance; the 
+** precursor list and weights are moved rather than copied.
+*/
+wdata& wdata::operator=(wdata &&wd) {
+  ct        = wd.ct;
+  sz        = wd.sz;
+  fmax      = wd.fmax;
+  fsize     = wd.fsize;
+  populated = wd.populated;
+  thr       = wd.thr;
+  prec      = std::move(wd.prec);
+  weights   = std::move(wd.weights);
+  return *this;
+} // end "=" (move assignment) operator definition
+
 /*
 ** The clear() function initializes all data in the wdata struct.  Any data 
 ** currently residing in the struct is lost.
@@ -27,7 +211,7 @@ void wdata::clear(int s) {
   ct  = 0;
   sz  = s;
   thr = 0.5;
-  prec.erase(prec.begin(), prec.end());
+  prec.clear();
   weights.resize(s);
   populated = false;
 } // end clear()
@@ -37,56 +221,31 @@ void wdata::clear(int s) {
 ** instance.  Used in the assignment operator and the copy constructor.
 */
 void wdata::copy(const wdata &wd) { 
-  list<Svect>::const_iterator it;
   ct = wd.ct;
   sz = wd.sz;
   populated = wd.populated;
-  it = wd.prec.cbegin(); 
-  while (it != wd.prec.cend()) { 
-    prec.push_front(*it); 
-    it++; 
-  } // end while (it)
+  prec = wd.prec;
 } // end copy()
 
 /*
-** The add() function adds a vector to the precursor data.  This data will be
-** used as a list of examples to run the logistic regression on.
+** The add() function adds an example (the position of the word in the corpus) to
+** the precursor data.  This data will be used as a list of examples to run the
+** logistic regression on.
 */
-void wdata::add(Svect &v) { 
-  prec.push_front(v); 
+void wdata::add(int t) { 
+  prec.add(t); 
 } // end add()
 
-/*
-** The front() function returns a reference to the first element of the
-** precursor data.  The "lit" iterator is a persistent iterator that will
-** be used in the next() function; it is reset to the beginning of the list
-** when the front() function is called.
-*/
-Svect& wdata::front(void) {
-  lit=prec.begin();
-  return *lit;
-} // end front()
-
-/*
-** The next() function returns a reference to the next element of the
-** precursor data that is pointed to by the "lit" iterator after it is
-** incremented.
-*/
-Svect& wdata::next(void) {
-  lit++; 
-  if (lit == prec.end()) lit=prec.begin(); 
-  return *lit;
-}
-
 /*
 ** The size() function returns the size of the precursor list (# of elements).
 */
 int wdata::size(void) { return prec.size(); }
 
 /*
-** The incr() function increments the usage count of the word.
+** The incr() function increments the usage count of the word (by one, unless
+** another amount is given).
 */
-void wdata::incr(void) { ct++; }
+void wdata::incr(int n) { ct += n; }
 
 /*
 ** The count() function returns the usage count of the word.
@@ -102,51 +261,55 @@ bool wdata::is_populated(void) { return populated; }
 
 /*
 ** The init_weights() function initializes the weights used in the logistic
-** regression.  It first adds in all of the data from each precursor so that
-** there is an explicit element in the weights vector for every explicit
-** element used in the precursor list.  It then replaces the data for each
-** explicit element with an initial weight (supplied in the argument).
+** regression.  It first collects the ordinal of every word in the precursor
+** examples (made from the corpus) so that there is an explicit element in the
+** weights vector for every word used in them, and each of these elements is
+** then set to an initial weight (supplied in the argument).
 */
-void wdata::init_weights(double w) { 
-  list<Svect>::iterator it;
+void wdata::init_weights(double w, const Corpus &cp) { 
+  vector<int> used;
+  Prec        p[NVEC];
 
   // nothing to do if there is no precursor data
-  if (prec.begin() == prec.end()) return; 
-
-  it = prec.begin(); 
-  weights = *it;
-  it++; 
-  while (it != prec.end()) { 
-    weights += *it; 
-    it++; 
-  } // end while (lit);
-  weights = w; // overwrite all of the explicit data with the initial weight supplied
+  if (prec.empty()) return; 
+
+  for (int i=0; i<prec.size(); i++) {
+    cp.features(prec[i], p);
+    for (int k=0; (k < NVEC) && (p[k].ord >= 0); k++) used.push_back(p[k].ord);
+  } // end for (i)
+  sort(used.begin(), used.end());
+  used.erase(unique(used.begin(), used.end()), used.end());
+
+  weights.resize(MAXD);
+  for (int k=0; k<(int)used.size(); k++) weights.sete(used[k], w);
   populated = false;
 } // end init_weights()
 
 
 /*
 ** The init_logr() function initializes the data used in the logistic 
-** regression.
+** regression.  The features matrix is cleared and a row is appended for
+** each positive example (up to PMAX of them), with a matching observation
+** of one for each.  The total number of examples is set to leave room for
+** "r" negative examples for each positive one (up to FMAX in all).
 */
-void wdata::init_logr(double w, Svect *feat, Svect &obsv) {
-  list<Svect>::iterator it;
+void wdata::init_logr(double w, const Corpus &cp, Smat &feat, Svect &obsv, int r) {
   int i = 0; 
 
-  if (w != 0) init_weights(w);
-  fmax = 10*prec.size();             // setting max size of features vector
-  if (fmax > 500) fmax = 500;
+  if (w != 0) init_weights(w, cp);
+  fmax = (1+r)*min(prec.size(), PMAX); // setting max number of examples
+  if (fmax > FMAX) fmax = FMAX;
   //cout << "fmax = " << fmax << endl;
-  obsv.resize(prec.size());           // clear and size the observations vector
-  obsv.setall(1);                     // set all of these observations to 1
+  feat.clear(prec.empty()?sz:MAXD);
 
-  it = prec.begin();
-  while (it != prec.end()) {         // copy precursor data to features
-    if (i >= 100) break;
-    feat[i++] = *it; 
-    it++; 
-  } // end while (it)
+  while (i < prec.size()) {          // copy precursor data to features
+    if (i >= PMAX) break;
+    addrow(cp, prec[i], feat); 
+    i++;
+  } // end while (i)
 
+  obsv.resize(i);                    // clear and size the observations vector
+  obsv.setall(1);                    // set all of these observations to 1
   fsize = i;
 } // end init_logr()
 
@@ -158,18 +321,16 @@ void wdata::init_logr(double w, Svect *feat, Svect &obsv) {
 ** positive observations should be relatively small in size compared to the 
 ** negative observations in order to yield an accurate regression.
 */
-void wdata::add_negs(list<Svect> &negs, Svect *feat, Svect &obsv) {
-  list<Svect>::iterator it;
+void wdata::add_negs(const Pstore &negs, const Corpus &cp, Smat &feat, Svect &obsv) {
   int i = fsize;
 
-  it = negs.begin();
-  while (it != negs.end()) {
-    if (i >= fmax) { fsize = fmax; return; }
-    feat[i++] = *it;
-    it++;
-  } // end while (it)
+  for (int k=0; k<negs.size(); k++) {
+    if (i >= fmax) break;
+    addrow(cp, negs[k], feat);
+    i++;
+  } // end for (k)
 
-  obsv.upsize(i);
+  obsv.upsize(i);                    // the negative observations are all (implicit) zeroes
   fsize = i;
 } // end add_negs()
 
@@ -194,6 +355,13 @@ int wdata::num_obs(void) { return fmax; }
 double wdata::find_prob(Svect &p) {
   double               wTx;
 
-  wTx  = (weights * p).sum();
+  wTx  = dot(weights, p);
   return exp(wTx)/(1 + exp(wTx));
-}
\ No newline at end of file
+}
+
+/*
+** The find_wTx() function returns the weighted sum of the precursors (the
+** argument of the logistic function used by find_prob()), so that the 
+** logistic function can be applied to many words at once.
+*/
+double wdata::find_wTx(Svect &p) { return dot(weights, p); }
\ No newline at end of file
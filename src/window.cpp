@@ -0,0 +1,55 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library implements the sliding window of precursor words (Window).  See window.h.
+*/
+
+#include "../include/window.h"
+
+using namespace std;
+
+/*
+** Constructor (the window starts out empty).
+*/
+Window::Window() { clear(); }
+
+/*
+** The clear() function empties the window.
+*/
+void Window::clear(void) { head = 0; n = 0; }
+
+/*
+** The push() function adds the ordinal of the next word to the window.  If the
+** window is already full, the oldest word is overwritten.
+*/
+void Window::push(int ord) {
+  if (n < NVEC) { ords[(head + n) % NVEC] = ord; n++; }
+  else          { ords[head] = ord; head = (head + 1) % NVEC; }
+} // end push()
+
+int Window::count(void) const { return n; }
+
+/*
+** The features() function sets NVEC records to the precursor example for the words
+** in the window (see precursors()), after putting them in order from the oldest.
+*/
+void Window::features(Prec *rec) const {
+  int win[NVEC];
+
+  for (int p=0; p<n; p++) win[p] = ords[(head + p) % NVEC];
+  precursors(win, n, rec);
+} // end features()
+
+/*
+** This features() function sets a vector (keeping its size) to the precursor vector
+** for the words in the window: vec[ordinal] = position.  Since the records are sorted
+** by ordinal, every entry is appended at the end of the vector.
+*/
+void Window::features(Svect &vec) const {
+  Prec rec[NVEC];
+
+  features(rec);
+  vec.resize(vec.size());
+  for (int k=0; (k < NVEC) && (rec[k].ord >= 0); k++) vec.sete(rec[k].ord, rec[k].pos);
+} // end features()
@@ -30,6 +30,9 @@ ostream& operator<<(ostream& os, const wordvect& w) {
 */
 wordvect::wordvect(void) { 
   wd=new wdata; 
+  corpus=nullptr; 
+  negs=nullptr; 
+  opts=nullptr; 
   clear(); 
 } // end default constructor
 
@@ -55,6 +58,18 @@ wordvect::wordvect(const wordvect &w)
   copy(w); 
 } // end copy constructor
 
+/*
+** The move constructor takes over the "wd" structure (and the rest of the data) of
+** an instance that is about to go away, so no new wdata is allocated or copied.  The
+** other instance is left without a "wd" structure and must not be used afterwards.
+*/
+wordvect::wordvect(wordvect &&w) noexcept
+  :train(w.train), test(w.test), corpus(w.corpus), negs(w.negs), opts(w.opts),
+   entry(std::move(w.entry)), ord(w.ord), wd(w.wd)
+{
+  w.wd = nullptr;
+} // end move constructor
+
 /*
 ** The destructor deallocates the "wd" structure that was dynamically 
 ** allocated in the constructor.
@@ -72,6 +87,26 @@ wordvect& wordvect::operator=(const wordvect &rhs) {
   return *this;
 } // end "=" (assignment) operator definition
 
+/*
+** This "=" (move assignment) operator takes over the data from an instance that is
+** about to go away.  The "wd" structures are swapped so that the old one is released
+** by the other instance.
+*/
+wordvect& wordvect::operator=(wordvect &&rhs) noexcept {
+  wdata *t;
+  entry  = std::move(rhs.entry);
+  ord    = rhs.ord;
+  train  = rhs.train;
+  test   = rhs.test;
+  corpus = rhs.corpus;
+  negs   = rhs.negs;
+  opts   = rhs.opts;
+  t      = wd;
+  wd     = rhs.wd;
+  rhs.wd = t;
+  return *this;
+} // end "=" (move assignment) operator definition
+
 /*
 ** This "=" (assignment) operator copies the string on the rhs of the 
 ** operator to the string data for this instance.
@@ -123,10 +158,13 @@ bool wordvect::operator<(const string &sw) {
 ** structure.
 */
 void wordvect::copy(const wordvect &w) { 
-  entry = w.entry; 
-  ord   = w.ord; 
-  train = w.train;
-  test  = w.test;
+  entry  = w.entry; 
+  ord    = w.ord; 
+  train  = w.train;
+  test   = w.test;
+  corpus = w.corpus;
+  negs   = w.negs;
+  opts   = w.opts;
   wd->copy(*w.wd); 
 } // end copy()
 
@@ -163,7 +201,7 @@ void wordvect::clear(void) {
 /*
 ** The str() function returns the value stored in the "entry" variable.
 */
-string wordvect::str(void) const { return entry; }
+const string& wordvect::str(void) const { return entry; }
 
 
 /*
@@ -188,10 +226,20 @@ int wordvect::count(void) const {
 */
 int wordvect::num_obs(void) const {
   wdata *w;
+  int    n;
   w = wd;
-  return (w->prec.size()*10<500?(w->prec.size()*10):500);
+  n = (1 + negratio())*min(w->prec.size(), PMAX);
+  return (n<FMAX?n:FMAX);
 }
 
+/*
+** The negratio() function returns the number of negative examples used for each
+** positive example in a regression (the default if there is no sampler).
+*/
+int wordvect::negratio(void) const {
+  return ((negs != nullptr) ? negs->ratio() : NEGRATIO);
+} // end negratio()
+
 /*
 ** The setord() function sets the ordinal (unique identifier) of the word.
 ** This cannot be changed after the word is added to the dictionary.
@@ -209,13 +257,13 @@ int wordvect::getord(void) const {
 
 /*
 ** The addprec() function is a pass-through function that adds a set of 
-** precursor words in the form of a sparse vector (Svect) to the wdata
-** substructure.
+** precursor words to the wdata substructure, in the form of the position
+** of this word in the corpus (the words before it are the precursors).
 */
-void wordvect::addprec(Svect &prec) const { 
+void wordvect::addprec(int t) const { 
   wdata *w; 
   w = wd; 
-  w->add(prec); 
+  w->add(t); 
 } // end addprec()
 
 /*
@@ -227,6 +275,25 @@ void wordvect::addprec(Svect &prec) const {
 void wordvect::set_train(list<WVit> *t) { train = t; }
 void wordvect::set_test(list<WVit> *t)  { test = t;  }
 
+/*
+** The set_corpus() function sets the pointer to the corpus that the precursor
+** examples are made from (the one that belongs to the same dictionary).
+*/
+void wordvect::set_corpus(const Corpus *c) { corpus = c; }
+
+/*
+** The set_sampler() function sets the pointer to the sampler that the negative
+** examples for a regression are drawn from (the one that belongs to the same
+** dictionary).
+*/
+void wordvect::set_sampler(const Sampler *s) { negs = s; }
+
+/*
+** The set_solver() function sets the pointer to the settings that the weights are
+** solved with (the ones that belong to the same dictionary).
+*/
+void wordvect::set_solver(const solver_opts *o) { opts = o; }
+
 /*
 ** The solve() function executes the correct series of initialization and
 ** iteration functions to solve for the weights vector, given a proper set
@@ -234,30 +301,26 @@ void wordvect::set_test(list<WVit> *t)  { test = t;  }
 */
 void wordvect::solve(double d, bool verbose) const {
   Datamodule           dm;
-  list<WVit>::iterator lit;
   wdata               *w;
-  Svect                features[500];
+  Smat                 features;
   Svect                observations;
+  Pstore               drawn;
+  mt19937              gen(NEGSEED + ord); // (the same draws for this word on any thread)
   int                  niter;
 
   w = wd; 
-  w->init_logr(d, features, observations); 
-  // For each word in the training set, adding the precursors that go with that
-  // particular word to the features if the ordinal does not match the word
-  // in this instance.  These are the negative observations, while the 
-  // init_logr() function initialized the positive observation data.
-  lit = train->begin();
-  while (lit != train->end()) {
-  	if (ord != (**lit).ord) {
-      w->add_negs((**lit).word_data()->prec, features, observations);
-    } // end if (ord)
-  	lit++;
-  } // end while (lit)
+  w->init_logr(d, *corpus, features, observations, negratio()); 
+  // Drawing examples at random from all of the examples of the words in the
+  // training set, leaving out the examples of the word in this instance, to
+  // fill the rest of the features.  These are the negative observations, while
+  // the init_logr() function initialized the positive observation data.
+  negs->draw(w->fmax - w->fsize, ord, *corpus, drawn, gen);
+  w->add_negs(drawn, *corpus, features, observations);
 
   dm.set_weights(w->weights);
-  dm.set_features(features);
+  dm.set_features(&features);
   dm.set_observations(observations);
-  niter = dm.getsoln(0.01, 1000);
+  niter = ((opts != nullptr) ? dm.getsoln(*opts) : dm.getsoln());
   dm.get_weights(w->weights);
   w->populated = true;
 
@@ -289,15 +352,13 @@ void wordvect::testsoln(void) const {
   Datamodule           dm;
   list<WVit>::iterator lit;
   wdata               *w;
-  Svect                features[500];
+  Smat                 features;
   Svect                observations;
   int                  niter;
 
   w = wd; 
-  // attempt to load a data file first if a data file exists
-  if (!w->is_populated()) read();
   if (w->is_populated()) { // nothing to do if weights aren't populated
-    w->init_logr(0, features, observations); 
+    w->init_logr(0, *corpus, features, observations, negratio()); 
 
     // For each word in the testing set, adding the precursors that go with that
     // particular word to the features if the ordinal does  not match the word in 
@@ -306,13 +367,13 @@ void wordvect::testsoln(void) const {
     lit = test->begin();
     while (lit != test->end()) {
       if (ord != (**lit).ord) {
-        w->add_negs((**lit).word_data()->prec, features, observations);
+        w->add_negs((**lit).word_data()->prec, *corpus, features, observations);
       } // end if (ord)
       lit++;
     } // end while (lit)
 
     dm.set_weights(w->weights);
-    dm.set_features(features);
+    dm.set_features(&features);
     dm.set_observations(observations);
 
     cout << "Testing results:" << endl;
@@ -337,14 +398,14 @@ double wordvect::find_optimal(void) const {
   Datamodule           dm;
   list<WVit>::iterator lit;
   wdata               *w;
-  Svect                features[500];
+  Smat                 features;
   Svect                observations;
   int                  niter;
   double               thr, tpr, fpr, dist, optDIST, optTPR, optFPR, optTHR, 
 					             res[4];
 
   w = wd; 
-  w->init_logr(0, features, observations); 
+  w->init_logr(0, *corpus, features, observations, negratio()); 
 
   // For each word in the testing set, adding the precursors that go with that
   // particular word to the features if the ordinal does  not match the word in 
@@ -354,13 +415,13 @@ double wordvect::find_optimal(void) const {
   lit = test->begin();
   while (lit != test->end()) {
   	if (ord != (**lit).ord) {
-	  w->add_negs((**lit).word_data()->prec, features, observations);
+	  w->add_negs((**lit).word_data()->prec, *corpus, features, observations);
 	} // end if (ord)
   	lit++;
   } // end while (lit)
 
   dm.set_weights(w->weights);
-  dm.set_features(features);
+  dm.set_features(&features);
   dm.set_observations(observations);
   dm.pred();
 
@@ -384,69 +445,26 @@ double wordvect::find_optimal(void) const {
 /*
 ** The find_prob() function is a pass-through function that finds the 
 ** probability that the word in this instance is the next one.  The return 
-** value is the probability.  If the weights vector is not populated, it checks
-** to see if there is a data file for this word. If this fails as well, it
+** value is the probability.  If the weights vector is not populated, it
 ** returns a zero.
 */
 double wordvect::find_prob(Svect &p) const {
   wdata *w = wd;
   if (w->is_populated()) return w->find_prob(p);
-  else {
-    if (read(false))     return w->find_prob(p);
-    else                 return 0.0;
-  } 
+  else                   return 0.0;
 }
 
 /*
-** The write() function creates an eponymous file in the "dict" subdirectory
-** to store the weights that were calculated using logistic regression.
+** The find_wTx() function is a pass-through function that finds the weighted
+** sum of the precursors for this word.  The weights must already be loaded.
 */
-bool wordvect::write(bool verbose) const {
-  ofstream ofile;
-  wdata *w = wd;
-  outdbl dout;
-  outint iout;
-  string fname;
-  int    expl, sz, position, index, composite;
-  double thr;
-
-  if (IS_PLATFORM(LINUX)) 
-    fname = "dict/" + entry + ".dat";
-  else if (IS_PLATFORM(WINDOWS))
-    fname = "dict\\" + entry + ".dat";
-
-  ofile.open(fname, ios::out | ios::binary);
-  if (ofile.is_open()) {
-  	expl = w->weights.count_explicit();
-  	sz   = w->weights.size();
-    thr  = w->thr;
-  	iout.i = expl;
-  	ofile.write(&iout.c[0],4);
-  	iout.i = sz;
-  	ofile.write(&iout.c[0],4);
-    dout.d = thr;
-    ofile.write(&dout.c[0],8);
-  	for (int i=0; i<sz; i++) {
-  		if (w->weights.is_explicit(i)) {
-  			iout.i = i;
- 			dout.d = w->weights[i];
- 			ofile.write(&iout.c[0],4);
- 			ofile.write(&dout.c[0],8);
-  		} // end if (weights) 
-  	} // end for (i)
-  	ofile.close();
-    return true;
-  } // end if (ofile)
-  else {
-  	if (verbose) cerr << "Could not open file \"dict\\" << entry << "\" for output." << endl;
-    return false;
-  } // end else (ofile)
-} // end write()
+double wordvect::find_wTx(Svect &p) const { return wd->find_wTx(p); }
 
 /*
 ** The read() function reads the weights from an eponymous file in the "dict" 
 ** subdirectory that were calculated using logistic regression and stored in 
-** the file at an earlier time.
+** the file by an older version (which wrote one data file per word).  It is
+** only used by the one-time import of those files, see Dict::import().
 */
 bool wordvect::read(bool verbose) const {
   ifstream ifile;
@@ -470,6 +488,8 @@ bool wordvect::read(bool verbose) const {
   	sz = iout.i;
     ifile.read(&dout.c[0],8);
     thr = dout.d;
+    // a file that is cut short or has impossible sizes is not used at all
+    if (!ifile || (sz < 0) || (expl < 0) || (expl > sz)) { ifile.close(); return false; }
   	//cout << "size = " << sz << endl;
   	w->weights.resize(sz);
   	//cout << "explicit = " << expl << endl;
@@ -480,6 +500,11 @@ bool wordvect::read(bool verbose) const {
   		dout.d = 0.0;
   		ifile.read(&iout.c[0],4);
   		ifile.read(&dout.c[0],8);
+      if (!ifile || (iout.i < 0) || (iout.i >= sz)) { 
+        w->weights.resize(0); 
+        ifile.close(); 
+        return false; 
+      } // end if (ifile)
 	  	w->weights[iout.i] = dout.d;
   	} // end for (i)
   	ifile.close();
@@ -490,4 +515,4 @@ bool wordvect::read(bool verbose) const {
   	if (verbose) cerr << "Could not open file \"" << fname << "\" for input." << endl;
     return false;
   } // end else (ofile)
-} // end write()
\ No newline at end of file
+} // end read()
\ No newline at end of file
@@ -0,0 +1,51 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This library implements a simple pool of worker threads (Workq).  See workq.h.
+*/
+
+#include "../include/workq.h"
+#include "../include/datamodule.h"
+
+using namespace std;
+
+/*
+** The constructor sets the number of workers.  If zero is given, one worker is
+** used for every thread the hardware supports.  The seeds for the workers start
+** just after the default seed (which the main thread uses).
+*/
+Workq::Workq(int n) : seed(default_random_engine::default_seed + 1) { workers(n); }
+
+/*
+** The workers() functions set and get the number of worker threads.  The number
+** is never less than one.
+*/
+void Workq::workers(int n) {
+  if (n <= 0) n = thread::hardware_concurrency();
+  nw = (n > 0)?n:1;
+} // end workers()
+
+int Workq::workers(void) const { return nw; }
+
+/*
+** The run() function starts the worker threads, each of which calls the job
+** function (with its worker number as the argument) until it returns false, and
+** then waits for all of them to finish.  Before starting, each worker seeds its
+** own copy of the RAND engine with the next seed of the pool, so that the workers
+** do not share a sequence and a later run does not repeat an earlier one.
+*/
+void Workq::run(function<bool(int)> job) {
+  vector<thread> pool;
+  unsigned       s;
+
+  for (int i=0; i<nw; i++) {
+    s = seed++;
+    pool.push_back(thread([job, i, s]() {
+      rand_gen.seed(s);
+      while (job(i));
+    }));
+  } // end for (i)
+
+  for (int i=0; i<nw; i++) pool[i].join();
+} // end run()
@@ -0,0 +1,107 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This test solves the same logistic regression with each of the methods that getsoln()
+** can use and checks that every one of them reaches the objective function found by
+** L-BFGS (the default) to within a tolerance.  The stochastic methods only get as close
+** as the noise of their last steps allows, so the tolerance is a fraction of the
+** objective rather than the convergence tolerance.  The regression is a made up one that
+** is shaped like those of the dictionary: sparse rows with a few precursor features
+** each, and about NEGRATIO negative examples for each positive one.
+**
+** usage: solver_test
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/datamodule.h"
+#include "../include/wdata.h"
+
+using namespace std;
+
+#define NEX   2000 // the number of examples
+#define NCOL  3000 // the number of features
+#define NPREC 8    // the number of features in each example
+#define FTOL  0.005 // how far above the L-BFGS objective a method may stop (a fraction of it)
+
+/*
+** The makeset() function fills the features and the observations with examples drawn
+** from a fixed set of true weights, so that every run solves the same regression.
+*/
+static void makeset(Smat &x, Svect &y) {
+  mt19937                         gen(NEGSEED);
+  uniform_int_distribution<int>   col(0, NCOL-1);
+  uniform_real_distribution<double> u(0.0, 1.0);
+  vector<double>                  truth(NCOL);
+  vector<int>                     c;
+  vector<double>                  v;
+  double                          z;
+
+  for (int j=0; j<NCOL; j++) truth[j] = 4.0 * u(gen) - 2.0;
+  x.clear(NCOL);
+  y.resize(NEX);
+  for (int i=0; i<NEX; i++) {
+    c.clear();
+    v.clear();
+    while ((int)c.size() < NPREC) {
+      int j = col(gen);
+      if (find(c.begin(), c.end(), j) == c.end()) c.push_back(j);
+    } // end while (c)
+    sort(c.begin(), c.end());
+    z = -log((double)NEGRATIO);
+    for (int k=0; k<NPREC; k++) { v.push_back(1.0 + (k % 4)); z += truth[c[k]] / NPREC; }
+    x.add_row(c.data(), v.data(), NPREC);
+    y[i] = (u(gen) < 1.0 / (1.0 + exp(-z))) ? 1.0 : 0.0;
+  } // end for (i)
+} // end makeset()
+
+/*
+** The solve() function solves the regression with one method, starting from zero
+** weights, and returns the objective function that the solvers minimize at the
+** solution (the negative log-liklihood plus the L2 penalty).
+*/
+static double solve(Smat &x, Svect &y, int method) {
+  Datamodule  dm;
+  solver_opts opts;
+  Svect       w(NCOL);
+
+  rand_gen.seed(default_random_engine::default_seed);
+  opts.method = method;
+  dm.set_weights(w);
+  dm.set_features(&x);
+  dm.set_observations(y);
+  dm.getsoln(opts);
+  dm.get_weights(w);
+  return -LL(w, y, &x) + 0.5 * opts.lambda * dot(w, w);
+} // end solve()
+
+int main(int argc, char **argv) {
+  const int    methods[] = { SOLVER_GRADIENT, SOLVER_NEWTONCG, SOLVER_SGD, SOLVER_ADAGRAD,
+                             SOLVER_ADAM };
+  const string names[]   = { "gradient ascent", "Newton-CG", "SGD", "Adagrad", "Adam" };
+  Smat   x;
+  Svect  y;
+  double best, f;
+  int    nfail = 0;
+
+  makeset(x, y);
+  best = solve(x, y, SOLVER_LBFGS);
+  cout << "L-BFGS objective: " << best << endl;
+  for (int k=0; k<5; k++) {
+    f = solve(x, y, methods[k]);
+    if ((f != f) || (f > best * (1.0 + FTOL))) {
+      cerr << "FAILED: " << names[k] << " stopped at an objective of " << f
+           << " (L-BFGS reached " << best << ")" << endl;
+      nfail++;
+      continue;
+    } // end if (f)
+    cout << "passed: " << names[k] << " reaches the L-BFGS objective (" << f << ")" << endl;
+  } // end for (k)
+  return (nfail > 0) ? 1 : 0;
+} // end main()
@@ -0,0 +1,333 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This is a differential test of the tokenizer against the parser that it replaced.  For
+** each text file given, it checks that:
+**
+**   1. cleanword() gives the same result as the old cleanword() (the chain of range
+**      comparisons, kept below as the reference) for every whitespace-delimited piece
+**      and every line of the file, plus a set of random byte strings, at every SIMD
+**      level that the processor supports
+**   2. the Tokenizer gives the same words as the old parser (cleanword(), parse() and
+**      cleanword() again on each part) at every SIMD level, and with the second pass
+**      turned off it gives the same words as the old parser did for evalmodel() (no 
+**      second cleanword() pass)
+**   3. the precursor example of every word of the file is the same as the one that the
+**      old processfile() made (one vector shifted along the text, kept below as the
+**      reference), both from a Window (as evalmodel() makes it) and from the corpus
+**      (as the regressions make it, see Corpus::features() and precursors()), and the
+**      examples recorded for each word in the dictionary are the positions of that word
+**   4. processfile() stops reading after the same number of words as the old one did
+**      (at the end of the first whitespace-delimited piece of text after which there
+**      are more than maxwords words), for a range of values of maxwords
+**
+** usage: token_test <text file> [<text file> ...]
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../include/dict.h"
+#include "../include/token.h"
+#include "../include/window.h"
+#include "../include/simd.h"
+#include "../include/ingest.h"
+
+using namespace std;
+
+#define NRAND  200000 // the number of random byte strings checked
+#define NSTOP  40     // the number of values of maxwords checked
+
+/*
+** The oldclean() function is the cleanword() function that the tokenizer replaced,
+** kept as the reference.  (The only change is that a separator at the very start no
+** longer reads the character before the start of the empty output string; it adds a
+** space, which is what that read did in practice.)
+*/
+static string oldclean(string inword) {
+  unsigned char c;
+  int    len, i;
+  string outword;
+
+  // skipping any leading spaces
+  i = 0;
+  while (inword[i] == ' ') { i++; }
+  if (i > 0) inword = inword.substr(i,inword.length());
+
+  len = inword.length();
+  for (i = 0; i < len; i++) {
+    c = inword[i];
+    if ((((int)c >= 97) && ((int)c <= 122)) || ((int)c >= 223) || 
+        (((int)c == 39) && (i != 0) && (i != (len-1)))) { outword += c; }
+    else {
+      // change upper case to lower case
+      if      (((int)c >= 65) && ((int)c <= 90))  { c += 32; outword += c; }
+      else if (((int)c >= 192) && ((int)c <=222)) { c += 32; outword += c; }
+      // use only one space in a consecutive string of spaces
+      else if (outword.empty() || (outword[outword.length()-1] != ' ')) outword += ' ';
+    } // end else (c)
+  } // end for (i)
+  return outword;
+} // end oldclean()
+
+/*
+** The oldparse() function is the parse() function that the tokenizer replaced: it
+** splits a cleaned piece of text at its spaces (without the old limit of ten parts).
+*/
+static void oldparse(const string &instr, vector<string> &words) {
+  string word;
+  bool   newword = false;
+
+  words.clear();
+  for (int i=0; i<(int)instr.length(); i++) {
+    if (instr[i] == ' ') {
+      newword = true;
+    } // end if (instr)
+    else if (newword) {
+      words.push_back(word);
+      newword = false;
+      word = instr[i];
+    } // end else if (newword)
+    else {
+      word += instr[i];
+    } // end else (instr)
+  } // end for (i)
+  words.push_back(word);
+} // end oldparse()
+
+/*
+** The oldwords() function reads a text file into a list of words the way that the
+** old processfile() did (or the way that the old evalmodel() did, if "twopass" is
+** false).
+*/
+static void oldwords(const string &fname, vector<string> &out, bool twopass = true) {
+  ifstream       ifile(fname);
+  string         piece;
+  vector<string> parts;
+
+  out.clear();
+  while (ifile >> piece) {
+    oldparse(oldclean(piece), parts);
+    for (int j=0; j<(int)parts.size(); j++) {
+      if (twopass) parts[j] = oldclean(parts[j]);
+      if (parts[j] != "") out.push_back(parts[j]);
+    } // end for (j)
+  } // end while (ifile)
+} // end oldwords()
+
+/*
+** The oldcount() function returns the number of words that the old processfile() read
+** before it stopped early (it only checked the count after each whitespace-delimited
+** piece of text).  It also lists, in "split", the number of words before every piece
+** of text that has more than one word in it (the values of maxwords for which stopping
+** right after the word that goes over them would stop in the middle of a piece).
+*/
+static int oldcount(const string &fname, int maxwords, vector<int> &split) {
+  ifstream       ifile(fname);
+  string         piece;
+  vector<string> parts;
+  int            n = 0, m;
+
+  split.clear();
+  while (ifile >> piece) {
+    oldparse(oldclean(piece), parts);
+    m = 0;
+    for (int j=0; j<(int)parts.size(); j++) if (oldclean(parts[j]) != "") m++;
+    if (m > 1) split.push_back(n);
+    n += m;
+    if ((maxwords != 0) && (n > maxwords)) break; // early termination 
+  } // end while (ifile)
+  return n;
+} // end oldcount()
+
+/*
+** The newwords() function reads a text file into a list of words with the Tokenizer
+** (with the apostrophe rule of the second cleanword() pass turned on or off).
+*/
+static void newwords(const string &fname, vector<string> &out, bool edges = true) {
+  Tokenizer tok(edges);
+  string    word;
+
+  out.clear();
+  tok.open(fname);
+  while (tok.next(word)) out.push_back(word);
+} // end newwords()
+
+/*
+** The checkclean() function compares cleanword() with the reference for one string,
+** and reports the first few that do not match.
+*/
+static int nbad = 0;
+static void checkclean(const string &s) {
+  string o;
+
+  cleanword(s.data(), s.size(), o);
+  if (o == oldclean(s)) return;
+  if (nbad < 5) cerr << "cleanword() mismatch (" << simd_name() << "): [" << s << "]" << endl;
+  nbad++;
+} // end checkclean()
+
+/*
+** The same() functions return whether a precursor vector made the old way has exactly
+** the same explicit elements as another vector, or as a set of NVEC records.
+*/
+static bool same(const Svect &old, const Svect &v) {
+  if (old.count_explicit() != v.count_explicit()) return false;
+  for (int k=0; k<old.count_explicit(); k++) 
+    if ((old.index(k) != v.index(k)) || (old.value(k) != v.value(k))) return false;
+  return true;
+} // end same()
+static bool same(const Svect &old, const Prec *rec) {
+  int n = 0;
+
+  while ((n < NVEC) && (rec[n].ord >= 0)) n++;
+  if (old.count_explicit() != n) return false;
+  for (int k=0; k<n; k++) 
+    if ((old.index(k) != rec[k].ord) || (old.value(k) != rec[k].pos)) return false;
+  return true;
+} // end same()
+
+/*
+** The checkwindow() function reads a text file into a dictionary with the Tokenizer
+** and checks the precursor example of every word (see 3. above).  The reference is
+** the window of the old processfile(): the last NVEC words are kept as strings, and a
+** single vector is shifted along the text (every value decremented, the oldest word
+** removed unless it is also in a newer position, and the new word added with a value
+** of NVEC).  It returns the number of mismatches, and the number of words checked in
+** "nw".
+*/
+static int checkwindow(const string &fname, int &nw) {
+  Dict      d;
+  Tokenizer tok;
+  Window    win;
+  Corpus    corpus;
+  Prec      rec[NVEC];
+  Svect     prec_example(MAXD), wv(MAXD);
+  string    word, dropword, group[NVEC+1];
+  vector<int> nex;
+  WVit      wit;
+  bool      dup;
+  int       n = 0, bad = 0, o;
+
+  if (!tok.open(fname)) return 1;
+  while (tok.next(word)) {
+    wit = d.addword(word);
+    d.addtoken(wit);
+    corpus.push(wit->getord());
+    if (n < NVEC) {
+      group[n] = word;
+      prec_example[wit->getord()] = n+1;
+    } // end if (n)
+    else {
+      // the example of this word from the Window and from the corpus
+      win.features(wv);
+      corpus.features(n, rec);
+      if (!same(prec_example, wv) || !same(prec_example, rec)) {
+        if (bad < 5) cerr << "example mismatch at word " << n << " (" << word << "): old " 
+                          << prec_example << " Window " << wv << endl;
+        bad++;
+      } // end if (!same)
+      if (wit->getord() >= (int)nex.size()) nex.resize(wit->getord() + 1, 0);
+      nex[wit->getord()]++;
+
+      // moving the old window along (the old processfile() did exactly this)
+      group[NVEC] = word;
+      dup = false;
+      for (int i=1; i < NVEC; i++) if (group[0] == group[i]) dup = true;
+      if (!dup) dropword = group[0]; else dropword = "";
+      for (int i = 0; i < NVEC; i++) group[i] = group[i+1];
+      prec_example -= 1;
+      prec_example.remove(d[dropword].getord());
+      prec_example[wit->getord()] = NVEC;
+    } // end else (n)
+    win.push(wit->getord());
+    n++;
+  } // end while (tok)
+
+  // the examples recorded for each word have to be the positions of that word
+  for (o=0; d[o].getord() >= 0; o++) {
+    const Pstore &ps = d[o].word_data()->prec;
+    if (ps.size() != ((o < (int)nex.size()) ? nex[o] : 0)) { bad++; continue; }
+    for (int i=0; i<ps.size(); i++) if (corpus[ps[i]] != o) { bad++; break; }
+  } // end for (o)
+
+  nw = n;
+  return bad;
+} // end checkwindow()
+
+int main(int argc, char **argv) {
+  vector<string> ref, got, ref1, got1;
+  vector<int>    levels, split, stops;
+  string         s;
+  mt19937        gen(1);
+  int            fail = 0, n;
+
+  if (argc < 2) {
+    cerr << "usage: token_test <text file> [<text file> ...]" << endl;
+    return 2;
+  } // end if (argc)
+  for (int lvl=SIMD_SCALAR; lvl<=SIMD_AVX512; lvl++) 
+    if (simd_level(lvl) == lvl) levels.push_back(lvl);
+
+  for (int f=1; f<argc; f++) {
+    oldwords(argv[f], ref);
+    oldwords(argv[f], ref1, false);
+    for (int l=0; l<(int)levels.size(); l++) {
+      simd_level(levels[l]);
+
+      // 1. cleanword() against the reference
+      nbad = 0;
+      ifstream pieces(argv[f]);
+      while (pieces >> s) checkclean(s);
+      ifstream lines(argv[f]);
+      while (getline(lines, s)) checkclean(s);
+      for (int k=0; k<NRAND; k++) {
+        s.resize(gen() % 80);
+        for (int i=0; i<(int)s.size(); i++) s[i] = (char)(gen() % 256);
+        checkclean(s);
+      } // end for (k)
+
+      // 2. the words read by the Tokenizer against the old parser
+      newwords(argv[f], got);
+      cout << argv[f] << " (" << simd_name() << "): " << nbad << " cleanword() mismatches, "
+           << ref.size() << " words (old) vs " << got.size() << " words (new)"
+           << ((got == ref) ? ", identical" : ", DIFFERENT") << endl;
+      if ((nbad != 0) || (got != ref)) fail = 1;
+      newwords(argv[f], got1, false);
+      cout << argv[f] << " (" << simd_name() << ", one pass): " << ref1.size() 
+           << " words (old) vs " << got1.size() << " words (new)"
+           << ((got1 == ref1) ? ", identical" : ", DIFFERENT") << endl;
+      if (got1 != ref1) fail = 1;
+    } // end for (l)
+
+    // 3. the precursor examples from the Window and the corpus against the old window
+    nbad = checkwindow(argv[f], n);
+    cout << argv[f] << ": " << nbad << " precursor example mismatches in " << n 
+         << " words (old window vs Window and corpus)" << endl;
+    if (nbad != 0) fail = 1;
+
+    // 4. where processfile() stops against where the old processfile() stopped, for
+    //    values of maxwords that end in the middle of a piece of text and for others
+    oldcount(argv[f], 0, split);
+    nbad = 0;
+    for (int m=0; m<2*NSTOP; m++) {
+      Dict   d;
+      Ingest ing;
+      int    maxwords;
+
+      if (m < NSTOP) maxwords = split[(long)m * split.size() / NSTOP];
+      else           maxwords = (m * 7919) % 50000 + 1;
+      processfile(argv[f], d, ing, maxwords);
+      if (ing.n != oldcount(argv[f], maxwords, stops)) nbad++;
+    } // end for (m)
+    cout << argv[f] << ": processfile() stopped at a different word than the old one for "
+         << nbad << " of " << 2*NSTOP << " values of maxwords" << endl;
+    if (nbad != 0) fail = 1;
+  } // end for (f)
+
+  cout << (fail ? "FAILED" : "passed") << endl;
+  return fail;
+} // end main()
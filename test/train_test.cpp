@@ -0,0 +1,146 @@
+/*
+** Created by: Jason Orender
+** (c) 2018 all rights reserved
+**
+** This test calculates the same regressions with one worker and with several workers and
+** checks that the packed model files written by save() are identical, i.e. that a model
+** does not depend on which worker calculates it (or on how many there are).  It also reads
+** the text file serially and in parallel shards, and checks that the dictionary indexes
+** and the packed model files written afterwards are identical; and the same for a read
+** that is stopped and resumed twice against one read of the same number of words.  It
+** writes the files into "dict" under the current directory, so it is run from a scratch
+** directory (see the "test" target in the Makefile).
+**
+** usage: train_test <text file> [# of workers]
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "../include/dict.h"
+#include "../include/token.h"
+#include "../include/workq.h"
+#include "../include/ingest.h"
+
+using namespace std;
+
+#define NTRAIN 8   // the number of regressions calculated
+#define NOBS   300 // the number of observations a word needs to be regressed
+#define NWORDS 20000 // the number of words read for the check of a resumed read
+
+/*
+** The Saved structure holds the contents of the dictionary index and of the packed model
+** file written at the end of a run, which are compared byte for byte.
+*/
+struct Saved { string idx, pak; };
+
+/*
+** The slurp() function returns the contents of a file (empty if there is none).
+*/
+static string slurp(const string &path) {
+  ifstream      ifile;
+  ostringstream buf;
+
+  ifile.open(path, ios::in | ios::binary);
+  if (!ifile.is_open()) return "";
+  buf << ifile.rdbuf();
+  return buf.str();
+} // end slurp()
+
+/*
+** The train() function reads the text file with processfile(), calculates the 
+** regressions for the first NTRAIN words (by ordinal) with enough observations using
+** "nw" workers, saves the dictionary index and the models and returns what was 
+** written.  If no stops are given, the whole file is read (serially if "ns" is 1, or
+** else in "ns" parallel shards); otherwise the file is read up to the first number of
+** words, and then resumed up to each of the others in turn.
+*/
+static Saved train(const string &fname, int nw, int ns, const vector<int> &stops = vector<int>()) {
+  Dict           d;
+  Ingest         ing;
+  Workq          pool(nw);
+  vector<string> todo;
+  mutex          qlock;
+  Saved          out;
+  int            next = 0;
+
+  // the same training and testing sets every time
+  rand_gen.seed(default_random_engine::default_seed);
+  if (stops.empty()) processfile(fname, d, ing, 0, ns);
+  for (int k=0; k<(int)stops.size(); k++) processfile(fname, d, ing, stops[k], 1, (k > 0));
+  for (int o=0; (int)todo.size() < NTRAIN; o++) {
+    if (d[o].getord() < 0) break;
+    if (d[o].num_obs() > NOBS) todo.push_back(d[o].str());
+  } // end for (o)
+  if (todo.empty()) return out;
+
+  pool.run([&](int) -> bool {
+    string word;
+    {
+      lock_guard<mutex> lock(qlock);
+      if (next >= (int)todo.size()) return false;
+      word = todo[next++];
+    }
+    d[word].solve(0.5);
+    d[word].find_optimal();
+    return true;
+  }); // end pool.run()
+
+  d.write();
+  if (!d.save()) return out;
+  out.idx = slurp("dict/dict.idx");
+  out.pak = slurp("dict/model.pak");
+  return out;
+} // end train()
+
+int main(int argc, char **argv) {
+  Saved one, many, shard, whole, resumed;
+  int   nw = 4;
+
+  if (argc < 2) {
+    cerr << "usage: train_test <text file> [# of workers]" << endl;
+    return 2;
+  } // end if (argc)
+  if (argc > 2) nw = atoi(argv[2]);
+
+  one   = train(argv[1], 1, 1);
+  many  = train(argv[1], nw, 1);
+  shard = train(argv[1], 1, nw);
+  if (one.pak.empty() || many.pak.empty() || shard.pak.empty()) {
+    cerr << "FAILED: could not train and save the models" << endl;
+    return 1;
+  } // end if (one)
+  if (one.pak != many.pak) {
+    cerr << "FAILED: the models trained with 1 and " << nw << " workers differ" << endl;
+    return 1;
+  } // end if (one)
+  cout << "passed: the models trained with 1 and " << nw << " workers are identical ("
+       << one.pak.size() << " bytes)" << endl;
+
+  // the file read in shards has to give the same dictionary, corpus and examples as the
+  // file read serially, so the dictionary index and the models have to be the same
+  if ((one.idx != shard.idx) || (one.pak != shard.pak)) {
+    cerr << "FAILED: the dictionary or the models from a serial read and from " << nw
+         << " shards differ" << endl;
+    return 1;
+  } // end if (one)
+  cout << "passed: the dictionary (" << one.idx.size() << " bytes) and the models from a "
+       << "serial read and from " << nw << " shards are identical" << endl;
+
+  // a read that is stopped and then resumed (as when more examples are needed) has to
+  // give the same dictionary and models as one read of the same number of words
+  whole   = train(argv[1], 1, 1, vector<int>{NWORDS});
+  resumed = train(argv[1], 1, 1, vector<int>{NWORDS/4, NWORDS/2, NWORDS});
+  if (whole.pak.empty() || (whole.idx != resumed.idx) || (whole.pak != resumed.pak)) {
+    cerr << "FAILED: the dictionary or the models from a resumed read and from one read of "
+         << NWORDS << " words differ" << endl;
+    return 1;
+  } // end if (whole)
+  cout << "passed: the dictionary and the models from a resumed read and from one read of "
+       << NWORDS << " words are identical" << endl;
+  return 0;
+} // end main()